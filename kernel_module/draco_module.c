@@ -2,12 +2,70 @@
 #include "draco_module.h"
 
 int init_hash_table(hash_table_type* hash_table_internal) {
+	registry_shard_type* shard;
+	int cpu;
+
 	#ifdef DEBUG_DRACO
 		printk (KERN_DEBUG "[Draco:init_hash_table()]: Enter hash_table\n");
 	#endif
 
 	memset(hash_table_internal, 0, sizeof(hash_table_type));
-	hash_table_internal->process_head.next = NULL;
+
+	hash_table_internal->registry = alloc_percpu(registry_shard_type);
+	if (hash_table_internal->registry == NULL) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:init_hash_table()]:registry alloc_percpu failed....");
+		#endif
+		return -ENOMEM;
+	}
+	for_each_possible_cpu(cpu) {
+		shard = per_cpu_ptr(hash_table_internal->registry, cpu);
+		spin_lock_init(&shard->lock);
+		INIT_HLIST_HEAD(&shard->head);
+	}
+
+	hash_table_internal->syscall_table_cache = kmem_cache_create(
+		"draco_syscall_table", sizeof(hash_table_per_process_per_syscall_type),
+		0, SLAB_HWCACHE_ALIGN, NULL);
+	hash_table_internal->process_table_cache = kmem_cache_create(
+		"draco_process_table", sizeof(hash_table_per_process_type),
+		0, SLAB_HWCACHE_ALIGN, NULL);
+	if (hash_table_internal->syscall_table_cache == NULL || 
+		hash_table_internal->process_table_cache == NULL) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:init_hash_table()]:kmem_cache_create failed....");
+		#endif
+		kmem_cache_destroy(hash_table_internal->syscall_table_cache);
+		kmem_cache_destroy(hash_table_internal->process_table_cache);
+		free_percpu(hash_table_internal->registry);
+		return -ENOMEM;
+	}
+
+	// Ours alone, so that unload waits for no other module's work.
+	hash_table_internal->workqueue = alloc_workqueue("draco", WQ_UNBOUND, 0);
+	if (hash_table_internal->workqueue == NULL) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:init_hash_table()]:alloc_workqueue failed....");
+		#endif
+		kmem_cache_destroy(hash_table_internal->syscall_table_cache);
+		kmem_cache_destroy(hash_table_internal->process_table_cache);
+		free_percpu(hash_table_internal->registry);
+		return -ENOMEM;
+	}
+
+	#ifdef METRICS_DRACO
+		hash_table_internal->metrics = alloc_percpu(total_metrics_type);
+		if (hash_table_internal->metrics == NULL) {
+			#ifdef ALERT_DRACO
+				printk (KERN_WARNING "[Draco:init_hash_table()]:metrics alloc_percpu failed....");
+			#endif
+			destroy_workqueue(hash_table_internal->workqueue);
+			kmem_cache_destroy(hash_table_internal->syscall_table_cache);
+			kmem_cache_destroy(hash_table_internal->process_table_cache);
+			free_percpu(hash_table_internal->registry);
+			return -ENOMEM;
+		}
+	#endif
 	
 	#ifdef DEBUG_DRACO
 		printk (KERN_DEBUG "[Draco:init_hash_table()]:Hash table is initialized....\n");
@@ -37,6 +95,48 @@ inline unsigned long get_argument(struct pt_regs* regs, uint8_t index) {
 	};
 }
 
+/*
+ * What the filter can tell apart of an argument: the bits under its mask,
+ * or, for an argument only compared against constants, the interval
+ * between two cuts it falls in, so that one entry covers the interval.
+ */
+inline unsigned long canonical_argument(
+	struct seccomp_draco_config* config, int syscall, uint8_t position, unsigned long value) {
+
+	struct seccomp_draco_block* block = &config->draco[syscall];
+	int arg = position - 1;
+	unsigned long* cuts;
+	int low = 0;
+	int high = block->cut_count[arg];
+	int middle;
+
+	value &= block->arg_mask[arg];
+	if (high == 0 || (block->exact & (1 << arg))) {
+		return value;
+	}
+
+	// The number of cuts at or below the value.
+	cuts = config->draco_cuts + block->cut_start[arg];
+	while (low < high) {
+		middle = (low + high) / 2;
+		if (cuts[middle] <= value) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+ * The tuples of a cache were checked against one filter, and keyed the
+ * way one configuration of masks and intervals says.
+ */
+static inline int built_for(hash_table_per_process_type* per_process, struct seccomp* seccomp) {
+	return per_process->filter == seccomp->filter && 
+		per_process->generation == seccomp->draco_generation;
+}
+
 inline void init_key(
 	key_type* k,\
 	int syscall_id,\
@@ -47,330 +147,2710 @@ inline void init_key(
 	k->regs = regs;
 }
 
-inline hash_table_per_process_per_syscall_type* get_item_from_pool(
-	hash_table_type* hash_table) {
+inline hash_table_per_process_per_syscall_type* alloc_syscall_table(
+	hash_table_type* hash_table, u32 size, int argument_count, int node, 
+	draco_cgroup_type* cgroup) {
 		
-	per_syscall_call_pool_type* p = &(hash_table->pool);
-	int bias = p->cursor;
+	hash_table_per_process_per_syscall_type* item;
 	
-	if (p->cursor == PRE_ALLOCATED_SYSCALL_TABLE_COUNT) {
+	item = kmem_cache_alloc_node(hash_table->syscall_table_cache, 
+		KMALLOC_FLAG | __GFP_ZERO, node);
+	if (item == NULL) {
 		return NULL;
 	}
 
-	++(p->cursor);
-
-	return p->pool_internal+bias;
-}
+	// The hash table itself waits for install_argument_table().
+	item->argument_count = argument_count;
+	item->initial_size = size;
+	item->node = node;
+	item->cgroup = cgroup;
+	spin_lock_init(&item->lock);
+	seqcount_init(&item->seq);
+	INIT_WORK(&item->grow_work, grow_work_handler);
 
-int insert_value(
-	hash_table_type* hash_table, 
-	key_type* key
-	) {
-	
-	int index = 0;
-	hash_table_per_process_type* per_process;
-	hash_table_per_process_per_syscall_type** sys_table;	
-	uint8_t* argument_positions;
-	int argument_count;	
-	u32 hash_code;
+	item->window = alloc_percpu(sample_window_type);
+	if (item->window == NULL) {
+		kmem_cache_free(hash_table->syscall_table_cache, item);
+		return NULL;
+	}
 
-	#ifdef DEBUG_DRACO
-		int syscall;
-		int j;
-	#endif	
+	#ifdef METRICS_DRACO
+		item->metrics = alloc_percpu(per_syscall_metrics_type);
+		if (item->metrics == NULL) {
+			free_percpu(item->window);
+			kmem_cache_free(hash_table->syscall_table_cache, item);
+			return NULL;
+		}
+	#endif
 
-	u32 entry_position;
-	unsigned long (*tb)[MAX_ARGUMENT_COUNT];
-	uint8_t* flag;
+	return item;
+}
 
-	if (hash_table == NULL) {
-		#ifdef ALERT_DRACO
-			printk (KERN_WARNING "[Draco:insert_value()]:initialization failed, don't use it....");
-		#endif
-		return 0;
-	}
+void free_syscall_table(
+	hash_table_type* hash_table,
+	hash_table_per_process_per_syscall_type* item) {
 
-	#ifdef DEBUG_DRACO
-		printk("[Draco:insert_value()]: Begin insert_value()");
+	// Nobody else holds the cache any more, the tables can go right away.
+	cancel_work_sync(&item->grow_work);
+	release_argument_table(item->grown);
+	release_argument_table(rcu_dereference_protected(item->old, 1));
+	release_argument_table(rcu_dereference_protected(item->active, 1));
+	free_percpu(item->window);
+	#ifdef METRICS_DRACO
+		free_percpu(item->metrics);
 	#endif
+	uncharge_cgroup(item->cgroup, sizeof(*item));
+	kmem_cache_free(hash_table->syscall_table_cache, item);
+}
+
+void free_process_table(
+	hash_table_type* hash_table,
+	hash_table_per_process_type* per_process) {
+
+	int index;
 
+	for (index = 0; index < SYSCALL_COUNT; ++index) {
+		if (per_process->syscall_table[index] != NULL) {
+			free_syscall_table(hash_table, per_process->syscall_table[index]);
+		}
+	}
 	#ifdef METRICS_DRACO
-		spin_lock(&draco_spinlock);
-		hash_table->total_call_count += 1;
-		spin_unlock(&draco_spinlock);
+		free_percpu(per_process->metrics);
 	#endif
-	
-	if (current->seccomp.draco_hook == NULL) {
-		process_node_type* temp;
-		hash_table_per_process_type* allocated_process;
-		#ifdef DEBUG_DRACO
-			spin_lock(&draco_spinlock);
-			printk("[Draco:insert_value()]:" 
-				"Begin allocating the space for the new process");
-			printk("[Draco:insert_value()]:Print profile info, totally %d syscalls\n", current->seccomp.draco_count);
-			
-			for (index = 0; index < current->seccomp.draco_count; ++index) {
-				syscall = current->seccomp.bit_map[index];
-				printk("syscall=%d:", syscall);
-				for (j = 0; j < current->seccomp.argument_count_table[syscall]; ++j) {
-					printk("%d", current->seccomp.sys2arguments[syscall][j]);
-				}
-				printk("\n");
-			}
-			spin_unlock(&draco_spinlock);
-		#endif
-		//Allocate the space for current->draco_hook
-		allocated_process = (hash_table_per_process_type*) 
-			kmalloc(sizeof(hash_table_per_process_type), KMALLOC_FLAG);
-		
-		if (unlikely(allocated_process == NULL)) {
+	uncharge_cgroup(per_process->cgroup, sizeof(*per_process));
+	put_cgroup(per_process->cgroup);
+	kmem_cache_free(hash_table->process_table_cache, per_process);
+}
 
-			#ifdef ALERT_DRACO
-				printk (KERN_WARNING 
-					"[Draco:insert_value()]:allocated_process kmalloc failed....");
-			#endif
+static void free_process_table_rcu(struct rcu_head* rcu) {
+	hash_table_per_process_type* per_process = 
+		container_of(rcu, hash_table_per_process_type, rcu);
 
-			return 0;
-		}
+	// Freeing the syscall tables may sleep, not in softirq.
+	queue_work(hash_table.workqueue, &per_process->free_work);
+}
 
+void free_process_table_work(struct work_struct* work) {
+	free_process_table(&hash_table, 
+		container_of(work, hash_table_per_process_type, free_work));
+}
 
-		memset(allocated_process, 0, sizeof(hash_table_per_process_type));
+static DEFINE_HASHTABLE(draco_cgroups, DRACO_CGROUP_BITS);
+static DEFINE_SPINLOCK(draco_cgroups_lock); // Adding to and removing from draco_cgroups.
 
-		spin_lock(&draco_spinlock);
-		#ifdef METRICS_DRACO
-			hash_table->total_process_count += 1;
-			allocated_process->per_process_argument_count = 0;
-			allocated_process->per_process_call_count = 0;
-			allocated_process->per_process_conflict_count = 0;
-			allocated_process->per_process_syscall_count = 0;
-			allocated_process->process_id = current->pid;
-			spin_unlock(&draco_spinlock);
+// Under rcu_read_lock(), NULL without memory cgroups.
+static struct cgroup_subsys_state* task_memory_css(struct task_struct* tsk) {
+	#ifdef CONFIG_MEMCG
+		#if LINUX_VERSION_CODE >= KERNEL_VERSION(3, 15, 0)
+			return task_css(tsk, memory_cgrp_id);
+		#else
+			return task_subsys_state(tsk, mem_cgroup_subsys_id);
 		#endif
-		current->seccomp.draco_hook = allocated_process;		
+	#else
+		return NULL;
+	#endif
+}
 
-		temp = hash_table->process_head.next;
-		hash_table->process_head.next = kmalloc(sizeof(process_node_type), KMALLOC_FLAG);
-		if (hash_table->process_head.next == NULL) {
-			#ifdef KERN_WARNING
-				printk("[draco:insert_value]: Failed to malloc\n");
-			#endif
-			spin_unlock(&draco_spinlock);
-			return 0;
+// The memory cgroup of current, with a reference, or NULL.
+static struct cgroup_subsys_state* current_memory_css(void) {
+	struct cgroup_subsys_state* css = NULL;
+
+	#ifdef CONFIG_MEMCG
+		// current may be moving to another cgroup, whose css is then live.
+		rcu_read_lock();
+		do {
+			css = task_memory_css(current);
+		} while (!css_tryget(css));
+		rcu_read_unlock();
+	#endif
+
+	return css;
+}
+
+// Under rcu_read_lock() or draco_cgroups_lock.
+static draco_cgroup_type* find_cgroup(struct cgroup_subsys_state* css) {
+	draco_cgroup_type* cgroup;
+
+	hash_for_each_possible_rcu(draco_cgroups, cgroup, node, (unsigned long)css) {
+		// One whose last cache is going is left alone, a new one replaces it.
+		if (cgroup->css == css && atomic_inc_not_zero(&cgroup->users)) {
+			return cgroup;
 		}
-		
-		hash_table->process_head.next->process = current;
-		hash_table->process_head.next->next = temp;
+	}
+	return NULL;
+}
+
+static void free_cgroup(draco_cgroup_type* cgroup) {
+	#ifdef METRICS_DRACO
+		free_percpu(cgroup->metrics);
+	#endif
+	kfree(cgroup);
+}
 
-		spin_unlock(&draco_spinlock);
+static void free_cgroup_rcu(struct rcu_head* rcu) {
+	free_cgroup(container_of(rcu, draco_cgroup_type, rcu));
+}
+
+/*
+ * The draco_cgroup of current's memory cgroup, with a reference for a new
+ * cache, or NULL if there is none and none could be allocated.
+ */
+draco_cgroup_type* get_cgroup(void) {
+	struct cgroup_subsys_state* css = current_memory_css();
+	draco_cgroup_type* cgroup;
+	draco_cgroup_type* allocated;
+
+	rcu_read_lock();
+	cgroup = find_cgroup(css);
+	rcu_read_unlock();
+	if (cgroup != NULL) {
+		goto out;
 	}
-	per_process = (hash_table_per_process_type*) current->seccomp.draco_hook;
 
+	allocated = kzalloc(sizeof(draco_cgroup_type), KMALLOC_FLAG);
+	if (allocated == NULL) {
+		goto out;
+	}
 	#ifdef METRICS_DRACO
-		spin_lock(&draco_spinlock);
-		per_process->per_process_call_count += 1;
-		spin_unlock(&draco_spinlock);
+		allocated->metrics = alloc_percpu(per_cgroup_metrics_type);
+		if (allocated->metrics == NULL) {
+			kfree(allocated);
+			goto out;
+		}
 	#endif
-	
-	sys_table = per_process->syscall_table;
+	allocated->css = css;
+	atomic_set(&allocated->users, 1);
 
-	if (sys_table[key->syscall_id] == NULL) {
-		#ifdef DEBUG_DRACO
-			printk("[Draco:insert_value()]:allocate the space for a new syscall");
-		#endif
-		sys_table[key->syscall_id] = get_item_from_pool(hash_table);
-		
-		if (sys_table[key->syscall_id] == NULL) {
-			
-			#ifdef ALERT_DRACO
-				printk (KERN_WARNING "malloc agument_table failed....");
-			#endif
-			
-			return 0;
+	// Another cache of the cgroup may have added one meanwhile.
+	spin_lock(&draco_cgroups_lock);
+	cgroup = find_cgroup(css);
+	if (cgroup == NULL) {
+		hash_add_rcu(draco_cgroups, &allocated->node, (unsigned long)css);
+		cgroup = allocated;
+		allocated = NULL;
+		css = NULL; // Its reference went to the new draco_cgroup.
+	}
+	spin_unlock(&draco_cgroups_lock);
+	if (allocated != NULL) {
+		free_cgroup(allocated);
+	}
+
+out:
+	if (css != NULL) {
+		css_put(css);
+	}
+	return cgroup;
+}
+
+/*
+ * Whether current's cgroup was denied a cache less than CGROUP_DENY_PERIOD
+ * ago. Takes no reference, so that the uncached syscalls of a cgroup over
+ * its budget do not each bounce its counters for a charge that would fail.
+ */
+int cgroup_denied(void) {
+	struct cgroup_subsys_state* css;
+	draco_cgroup_type* cgroup;
+	unsigned long until;
+	int denied = 0;
+
+	rcu_read_lock();
+	css = task_memory_css(current);
+	hash_for_each_possible_rcu(draco_cgroups, cgroup, node, (unsigned long)css) {
+		if (cgroup->css == css) {
+			until = READ_ONCE(cgroup->denied_until);
+			denied = until != 0 && time_before(jiffies, until);
+			break;
 		}
+	}
+	rcu_read_unlock();
+	return denied;
+}
+
+// Called by free_process_table(), never from softirq.
+void put_cgroup(draco_cgroup_type* cgroup) {
+	if (!atomic_dec_and_lock(&cgroup->users, &draco_cgroups_lock)) {
+		return;
+	}
+	hash_del_rcu(&cgroup->node);
+	spin_unlock(&draco_cgroups_lock);
+
+	if (cgroup->css != NULL) {
+		css_put(cgroup->css);
+	}
+	// The debugfs file may still be reading it.
+	call_rcu(&cgroup->rcu, free_cgroup_rcu);
+}
 
+/*
+ * Count @bytes against the cgroup_cache_kb of @cgroup before allocating
+ * them. Returns 0, and counts nothing, if they do not fit.
+ */
+int charge_cgroup(draco_cgroup_type* cgroup, unsigned long bytes) {
+	unsigned long limit = READ_ONCE(cgroup_cache_kb)*1024;
+
+	if ((unsigned long)atomic_long_add_return(bytes, &cgroup->bytes) > limit && limit != 0) {
+		atomic_long_sub(bytes, &cgroup->bytes);
 		#ifdef METRICS_DRACO
-			spin_lock(&draco_spinlock);
-			per_process->per_process_syscall_count += 1;
-			spin_unlock(&draco_spinlock);
+			this_cpu_inc(cgroup->metrics->per_cgroup_denied_count);
 		#endif
+		return 0;
 	}
+	return 1;
+}
 
-	#ifdef METRICS_DRACO
-		spin_lock(&draco_spinlock);
-		sys_table[key->syscall_id]->per_syscall_call_count += 1;
-		spin_unlock(&draco_spinlock);
-	#endif
-	
-	// Fill in argument
-  	argument_positions = current->seccomp.sys2arguments[key->syscall_id];
-  	argument_count = current->seccomp.argument_count_table[key->syscall_id];
-	
-  	for (index = 0; index < argument_count; ++index) {
-  		key->argument_list[index] = get_argument(
-  			key->regs, argument_positions[index]);
-  	}	
+void uncharge_cgroup(draco_cgroup_type* cgroup, unsigned long bytes) {
+	atomic_long_sub(bytes, &cgroup->bytes);
+}
 
-	hash_code = jhash((void* )key->argument_list,
-		sizeof(unsigned long)*argument_count, JHASH_INIT) % INIT_HASH_ARGUMENT;
+/*
+ * Make the kernel's own accounting of the allocations that follow, done
+ * by grow_work in a kworker, go to the memory cgroup of @cgroup rather
+ * than the kworker's. Older kernels cannot, and charge the kworker's.
+ */
+static struct mem_cgroup* use_cgroup_memcg(draco_cgroup_type* cgroup) {
+	#if defined(CONFIG_MEMCG) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+		if (cgroup->css != NULL) {
+			return set_active_memcg(mem_cgroup_from_css(cgroup->css));
+		}
+	#elif defined(CONFIG_MEMCG) && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+		if (cgroup->css != NULL) {
+			memalloc_use_memcg(mem_cgroup_from_css(cgroup->css));
+		}
+	#endif
+	return NULL;
+}
 
-	#ifdef DEBUG_DRACO
-		printk (KERN_DEBUG "[Draco:insert_value()]:hash_code=%d\n", hash_code);
+static void unuse_cgroup_memcg(draco_cgroup_type* cgroup, struct mem_cgroup* old) {
+	#if defined(CONFIG_MEMCG) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+		if (cgroup->css != NULL) {
+			set_active_memcg(old);
+		}
+	#elif defined(CONFIG_MEMCG) && LINUX_VERSION_CODE >= KERNEL_VERSION(4, 20, 0)
+		if (cgroup->css != NULL) {
+			memalloc_unuse_memcg();
+		}
 	#endif
+}
 
-	entry_position = hash_code*ASOS;
-	tb = sys_table[key->syscall_id]->table;
-	flag = sys_table[key->syscall_id]->flag;
-	
-	for (index = 0; index < ASOS && flag[entry_position+index] == 1; ++index) {
-		#ifdef DEBUG_DRACO
-			printk("[Draco:insert_value()]:Begin to compare arguments.....");
-		#endif
+void register_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process) {
+	registry_shard_type* shard;
 
-		if (memcmp(key->argument_list, 
-			tb[entry_position+index], 
-				argument_count*sizeof(unsigned long)) == 0) {
-			// Hit it.
+	per_process->shard = get_cpu();
+	shard = per_cpu_ptr(hash_table->registry, per_process->shard);
+	spin_lock(&shard->lock);
+	hlist_add_head_rcu(&per_process->registry, &shard->head);
+	spin_unlock(&shard->lock);
+	put_cpu();
+}
 
-			#ifdef DEBUG_DRACO
-				printk("[Draco:insert_value()]: hit !!");
-			#endif
+static DEFINE_HASHTABLE(draco_groups, DRACO_GROUP_BITS);
+static DEFINE_SPINLOCK(draco_groups_lock); // Adding to and removing from draco_groups.
 
-			#ifdef METRICS_DRACO
-				spin_lock(&draco_spinlock);
-				hash_table->total_hit_count += 1;
-				spin_unlock(&draco_spinlock);
-			#endif
-			
-			return 1;
-		}
-	}
+void publish_process_table(hash_table_per_process_type* per_process) {
+	per_process->group = current->signal;
+	spin_lock(&draco_groups_lock);
+	hash_add_rcu(draco_groups, &per_process->group_node, (unsigned long)per_process->group);
+	spin_unlock(&draco_groups_lock);
+}
 
-	#ifdef DEBUG_DRACO
-		printk("[Draco:insert_value()]: No hit~");
-	#endif
+void unpublish_process_table(hash_table_per_process_type* per_process) {
+	spin_lock(&draco_groups_lock);
+	if (!hlist_unhashed(&per_process->group_node)) {
+		hash_del_rcu(&per_process->group_node);
+	}
+	spin_unlock(&draco_groups_lock);
+}
 
-	// No hit, insert or discard
+/*
+ * A reference to a cache of current's thread group built for its filter
+ * and configuration, or NULL. Caches are freed after a grace period once
+ * unpublished, so one found here can be looked at until its reference is
+ * taken.
+ */
+hash_table_per_process_type* group_process_table(void) {
+	hash_table_per_process_type* per_process;
 
-	#ifdef METRICS_DRACO
-		spin_lock(&draco_spinlock);
+	rcu_read_lock();
+	hash_for_each_possible_rcu(draco_groups, per_process, group_node, (unsigned long)current->signal) {
+		if (per_process->group == current->signal && 
+			built_for(per_process, &current->seccomp) &&
+			atomic_inc_not_zero(&per_process->users)) {
+			rcu_read_unlock();
+			return per_process;
+		}
+	}
+	rcu_read_unlock();
+	return NULL;
+}
 
-		per_process->per_process_argument_count += 1;
-		sys_table[key->syscall_id]->per_syscall_argument_count += 1;
-		hash_table->total_argument_count += 1;
+/*
+ * Take @per_process off its shard. Returns 1 if this call did, and so
+ * owns freeing it; 0 if free_hash_table() got to it first.
+ */
+int unregister_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process) {
+	registry_shard_type* shard = per_cpu_ptr(hash_table->registry, per_process->shard);
+	int unregistered = 0;
 
-		spin_unlock(&draco_spinlock);
-	#endif
+	spin_lock(&shard->lock);
+	if (!hlist_unhashed(&per_process->registry)) {
+		hlist_del_init_rcu(&per_process->registry);
+		unregistered = 1;
+	}
+	spin_unlock(&shard->lock);
+	return unregistered;
+}
 
-	/// Conflict Discard
-	if (index == ASOS) {
-		
-		#ifdef METRICS_DRACO
-			spin_lock(&draco_spinlock);
+/*
+ * Called from do_exit() through draco_release, and when a thread leaves a
+ * cache it can no longer use. Each reference is taken off the task with
+ * xchg(), so that this cannot race with free_hash_table() detaching the
+ * same task at module unload; whoever drops the last reference frees the
+ * tables.
+ */
+void release_process_table(hash_table_type* hash_table, struct task_struct* tsk) {
+	rcu_read_lock();
+	put_process_table(hash_table, xchg(&tsk->seccomp.draco_hook, NULL));
+	put_process_table(hash_table, xchg(&tsk->seccomp.draco_parent, NULL));
+	rcu_read_unlock();
+}
 
-			hash_table->total_conflict_count += 1;
-			per_process->per_process_conflict_count += 1;
-			sys_table[key->syscall_id]->per_syscall_conflict_count += 1;
-			spin_unlock(&draco_spinlock);
-		#endif
+/*
+ * Drop a reference, under rcu_read_lock(). A cache losing its last one
+ * leaves the registry, is freed after a grace period and drops the
+ * reference it held on the cache it inherited from, and so on up the
+ * chain.
+ */
+void put_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process) {
+	hash_table_per_process_type* inherited;
 
-		return 0;
+	while (per_process != NULL && atomic_dec_and_test(&per_process->users)) {
+		inherited = per_process->inherited;
+		unpublish_process_table(per_process);
+		if (unregister_process_table(hash_table, per_process)) {
+			call_rcu(&per_process->rcu, free_process_table_rcu);
+		}
+		per_process = inherited;
 	}
-	// New entry, Insert
-	flag[entry_position+index] = 1;
+}
 
-	memcpy(tb[entry_position+index], key->argument_list, 
-		argument_count*sizeof(unsigned long));
+void free_dead_process_tables(hash_table_type* hash_table, struct list_head* dead) {
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_type* next;
 
-	return 0;
+	list_for_each_entry_safe(per_process, next, dead, list) {
+		list_del(&per_process->list);
+		free_process_table(hash_table, per_process);
+	}
 }
 
-void free_hash_table(hash_table_type* hash_table) {
-	process_node_type* traverse;
-	traverse = hash_table->process_head.next;
-	
-	#ifdef METRICS_DRACO
-		printk(KERN_INFO "[Draco:free_hash_table]:\n"
-			"total_hit_count = %d\n" 
-			"total_call_count =%d\n"
-			"total_argument_count = %d\n"
-			"total_conflict_count = %d\n"
-			"total_syscall_count = %d\n"
-			"total_process_count = %d\n\n",
-			hash_table->total_hit_count, 
-			hash_table->total_call_count,
-			hash_table->total_argument_count,
-			hash_table->total_conflict_count,
-			hash_table->total_syscall_count,
-			hash_table->total_process_count
-		);
-	#endif
+/*
+ * Called from copy_process() through draco_fork, once the fork can no
+ * longer fail, so every reference taken here is dropped by the child's
+ * do_exit(). The child still holds current's pointers, copied without a
+ * reference by copy_seccomp(); current keeps its own cache alive while it
+ * forks. A new thread shares the cache of its group; a forked child with
+ * the same filter gets a reference to it in draco_parent, to be inherited
+ * by the cache it builds.
+ */
+void share_process_table(struct task_struct* child) {
+	hash_table_per_process_type* per_process = child->seccomp.draco_hook;
 
-	while (traverse != NULL) {
-		process_node_type* cur = NULL;
-		hash_table_per_process_type* per_process;
-		per_process = traverse->process->seccomp.draco_hook;
-		
-		kfree(traverse->process->seccomp.draco_hook);
-		traverse->process->seccomp.draco_hook = NULL; // Deattach the task_struct
-		cur = traverse;
-		traverse = traverse->next;
-		kfree(cur);
+	child->seccomp.draco_hook = NULL;
+	child->seccomp.draco_parent = NULL;
+	if (per_process == NULL || !built_for(per_process, &child->seccomp)) {
+		return;
 	}
 
-	printk(KERN_INFO "Finish the draco free..............\n");
+	atomic_inc(&per_process->users);
+	if (child->group_leader == current->group_leader) {
+		child->seccomp.draco_hook = per_process;
+	} else {
+		child->seccomp.draco_parent = per_process;
+	}
 }
 
-static int __seccomp_filter_handler(int this_syscall, struct pt_regs *regs) {
+/*
+ * Look the arguments filled in @key up in the tables the caches up the
+ * chain have for this syscall, closest first. All of them were built
+ * under the same filter.
+ */
+int lookup_inherited(
+	hash_table_per_process_type* per_process, 
+	key_type* key, 
+	int argument_count, 
+	u32* verdict
+	) {
 
-	key_type key;
-	if (this_syscall < 0 || this_syscall >= SYSCALL_COUNT) {
+	hash_table_per_process_type* ancestor;
+	hash_table_per_process_per_syscall_type* sys;
 
-		#ifdef ALERT_DRACO
-			printk("Draco:__seccomp_filter_handler():"
-				"weirld syscall=%d\n"
-				"di=%lu\n"
-				"si=%lu\n"
-				"dx=%lu\n"
-				"r10=%lu\n"
-				"r8=%lu\n"
-				"r9=%lu\n",
-					this_syscall,
-					regs->di,
-					regs->si,
-					regs->dx,
-					regs->r10,
-					regs->r8,
-					regs->r9
-			);
-		#endif
+	for (ancestor = per_process->inherited; ancestor != NULL; ancestor = ancestor->inherited) {
+		sys = READ_ONCE(ancestor->syscall_table[key->syscall_id]);
+		if (sys != NULL && sys->argument_count == argument_count && 
+			lookup_syscall(sys, key, argument_count, verdict)) {
+			return 1;
+		}
+	}
+	return 0;
+}
 
+static u16 bucket_words(int argument_count) {
+	u32 bytes = ASOS*ROW_WORDS(argument_count)*sizeof(unsigned long);
+
+	if (argument_count == 0) {
 		return 0;
 	}
+	if (bytes <= L1_CACHE_BYTES) {
+		return roundup_pow_of_two(bytes)/sizeof(unsigned long);
+	}
+	return ALIGN(bytes, L1_CACHE_BYTES)/sizeof(unsigned long);
+}
 
+// What alloc_argument_table() allocates for such a table, in bytes.
+unsigned long argument_table_footprint(u32 size, int argument_count) {
+	unsigned long bytes = sizeof(argument_table_type);
 
-	#ifdef METRICS_DRACO 
-		if (syscall_number[this_syscall] == 0) {
-			hash_table.total_syscall_count += 1;
+	bytes += size*bucket_words(argument_count)*sizeof(unsigned long) + L1_CACHE_BYTES - 1;
+	bytes += size*sizeof(u64);
+	if (replacement == REPLACE_CLOCK) {
+		bytes += BITS_TO_LONGS(CLOCK_SET_BITS*size)*sizeof(unsigned long);
+	}
+	return bytes;
+}
+
+/*
+ * The arrays of a large table do not fit in what kmalloc() can give, e.g.
+ * the rows of HASH_ARGUMENT_LIMIT sets of a four-argument syscall, and
+ * fall back to vmalloc(). vfree() defers to a work item when called from
+ * the RCU callback that releases old tables.
+ */
+static void* alloc_table_array(size_t bytes, gfp_t flags, int node) {
+	#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
+		return kvzalloc_node(bytes, flags, node);
+	#else
+		void* array = NULL;
+
+		if (bytes <= KMALLOC_MAX_SIZE) {
+			array = kzalloc_node(bytes, flags | __GFP_NOWARN, node);
 		}
-		++syscall_number[this_syscall];
+		if (array == NULL) {
+			array = vzalloc_node(bytes, node);
+		}
+		return array;
 	#endif
-		
-	init_key(&key, this_syscall, regs);
-	return insert_value(&hash_table, &key);
 }
 
-static int __init draco_init(void) {
-	
-	draco_checker = __seccomp_filter_handler;
+static void free_table_array(const void* array) {
+	#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 12, 0)
+		kvfree(array);
+	#else
+		if (is_vmalloc_addr(array)) {
+			vfree(array);
+		} else {
+			kfree(array);
+		}
+	#endif
+}
 
-	init_hash_table(&hash_table);
+argument_table_type* alloc_argument_table(u32 size, int argument_count, gfp_t flags, int node) {
+	argument_table_type* t;
 
-	return 0;
+	t = kzalloc_node(sizeof(argument_table_type), flags, node);
+	if (t == NULL) {
+		return NULL;
+	}
+
+	BUILD_BUG_ON(ASOS*sizeof(u16) != sizeof(u64));
+
+	t->argument_count = argument_count;
+	t->bucket_words = bucket_words(argument_count);
+	t->table_memory = alloc_table_array((size_t)size*t->bucket_words*sizeof(unsigned long) + 
+		L1_CACHE_BYTES - 1, flags, node);
+	t->tags = alloc_table_array(size*sizeof(*t->tags), flags, node);
+	if (replacement == REPLACE_CLOCK) {
+		t->referenced = alloc_table_array(BITS_TO_LONGS(CLOCK_SET_BITS*size)*sizeof(unsigned long), 
+			flags, node);
+	}
+
+	if (t->table_memory == NULL || t->tags == NULL || 
+		(replacement == REPLACE_CLOCK && t->referenced == NULL)) {
+		release_argument_table(t);
+		return NULL;
+	}
+
+	t->table = PTR_ALIGN((unsigned long* )t->table_memory, L1_CACHE_BYTES);
+	t->size = size;
+	t->mask = is_power_of_2(size) ? size - 1 : 0;
+	t->set_bits = t->mask ? ilog2(size) : 0;
+	t->cuckoo = (backend == BACKEND_CUCKOO);
+	t->node = node;
+	return t;
 }
 
-static void __exit draco_exit(void) {
-	draco_checker = draco_checker_backup;
-	free_hash_table(&hash_table);
+void release_argument_table(argument_table_type* t) {
+	if (t == NULL) {
+		return;
+	}
+	if (t->cgroup != NULL) {
+		uncharge_cgroup(t->cgroup, argument_table_footprint(t->size, t->argument_count));
+	}
+	free_table_array(t->table_memory);
+	free_table_array(t->tags);
+	free_table_array(t->referenced);
+	kfree(t);
+}
+
+static void release_argument_table_rcu(struct rcu_head* rcu) {
+	release_argument_table(container_of(rcu, argument_table_type, rcu));
+}
+
+/*
+ * Give @sys its hash table on the first tuple that needs one. Returns 0
+ * only if there is none and none could be allocated.
+ */
+int install_argument_table(hash_table_per_process_per_syscall_type* sys) {
+	argument_table_type* allocated;
+
+	if (rcu_access_pointer(sys->active) != NULL) {
+		return 1;
+	}
+	if (!charge_cgroup(sys->cgroup, argument_table_footprint(sys->initial_size, sys->argument_count))) {
+		return 0;
+	}
+	allocated = alloc_argument_table(sys->initial_size, sys->argument_count, 
+		KMALLOC_FLAG, READ_ONCE(sys->node));
+	if (allocated == NULL) {
+		uncharge_cgroup(sys->cgroup, argument_table_footprint(sys->initial_size, sys->argument_count));
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:install_argument_table()]:allocating argument_table failed....");
+		#endif
+		return 0;
+	}
+	allocated->cgroup = sys->cgroup;
+
+	// Another thread of the group may have installed one meanwhile.
+	if (cmpxchg(&sys->active, NULL, allocated) != NULL) {
+		release_argument_table(allocated);
+	}
+	return 1;
+}
+
+static const u32 argument_table_sizes[] = {
+	37, 73, 149, 293, 587, 1171, 2341, 4679, 9349, 18691, 37379, 74747, 
+	149491, 298943, HASH_ARGUMENT_LIMIT
+};
+
+// Writes of "initial_sets" and "max_sets".
+static int param_set_sets(const char* value, const struct kernel_param* kp) {
+	uint sets;
+	int ret = kstrtouint(value, 0, &sets);
+
+	if (ret != 0) {
+		return ret;
+	}
+	if (sets < MIN_HASH_ARGUMENT) {
+		return -EINVAL;
+	}
+	WRITE_ONCE(*(uint* )kp->arg, sets);
+	return 0;
+}
+
+static u32 max_argument_table_size(void) {
+	return clamp_t(u32, READ_ONCE(max_sets), MIN_HASH_ARGUMENT, HASH_ARGUMENT_LIMIT);
+}
+
+static u32 initial_argument_table_size(void) {
+	u32 max_size = max_argument_table_size();
+	u32 size = clamp_t(u32, READ_ONCE(initial_sets), MIN_HASH_ARGUMENT, max_size);
+
+	if (hash_function == HASH_WORDS) {
+		size = roundup_pow_of_two(size);
+		return size > max_size ? rounddown_pow_of_two(max_size) : size;
+	}
+	return size;
+}
+
+// Never smaller than @size, max_sets may have been lowered since.
+static u32 next_argument_table_size(u32 size) {
+	u32 max_size = max_argument_table_size();
+	int index;
+
+	if (hash_function == HASH_WORDS) {
+		return max_t(u32, size, min_t(u32, size*2, rounddown_pow_of_two(max_size)));
+	}
+
+	for (index = 0; index < ARRAY_SIZE(argument_table_sizes); ++index) {
+		if (argument_table_sizes[index] > size) {
+			return max_t(u32, size, min_t(u32, argument_table_sizes[index], max_size));
+		}
+	}
+	return size;
+}
+
+/*
+ * The multiply-xorshift rounds leave the low bits of the result as well
+ * mixed as the high ones, so a power-of-two table can simply mask them.
+ */
+static inline u32 hash_words(unsigned long* argument_list, int argument_count) {
+	u64 hash_code = hash_seed;
+	int index;
+
+	for (index = 0; index < argument_count; ++index) {
+		hash_code = (hash_code ^ argument_list[index])*WORD_HASH_MULTIPLIER;
+		hash_code ^= hash_code >> 32;
+	}
+	return (u32)hash_code;
+}
+
+inline u32 hash_arguments(unsigned long* argument_list, int argument_count) {
+	if (hash_function == HASH_WORDS) {
+		return hash_words(argument_list, argument_count);
+	}
+	return jhash((void* )argument_list, 
+		sizeof(unsigned long)*argument_count, hash_seed);
+}
+
+static inline u32 reduce_set(argument_table_type* t, u32 hash_code) {
+	return t->mask ? (hash_code & t->mask) : (hash_code % t->size);
+}
+
+static inline u32 first_set(argument_table_type* t, u32 hash_code) {
+	return reduce_set(t, hash_code);
+}
+
+// The alternative set of the cuckoo backend, never equal to first_set():
+// every table has MIN_HASH_ARGUMENT sets at least.
+static inline u32 second_set(argument_table_type* t, u32 hash_code) {
+	u32 first = reduce_set(t, hash_code);
+	u32 second = reduce_set(t, jhash_1word(hash_code, CUCKOO_SEED));
+
+	return (second != first) ? second : reduce_set(t, first + 1);
+}
+
+/*
+ * The tag comes from what reduce_set() left of the hash: the bits above
+ * the mask, or the quotient of the modulo. Any bit it shared with the set
+ * index would be the same for every tuple of the set. Past 65536 sets
+ * fewer than 16 bits are left, which memcmp() makes up for.
+ */
+static inline u16 tag_of(argument_table_type* t, u32 hash_code) {
+	u16 tag = t->mask ? (hash_code >> t->set_bits) : (hash_code / t->size);
+
+	return (tag >= TAG_FIRST) ? tag : tag + TAG_FIRST;
+}
+
+static inline u16* tag_lane(argument_table_type* t, u32 position) {
+	return (u16* )t->tags + position;
+}
+
+static inline unsigned long* table_row(argument_table_type* t, u32 position) {
+	return t->table + (position/ASOS)*t->bucket_words + 
+		(position%ASOS)*ROW_WORDS(t->argument_count);
+}
+
+// The top bit of every 16-bit lane of the result is set iff that lane equals tag.
+static inline u64 match_tags(u64 tags, u16 tag) {
+	u64 x = tags ^ (TAG_LANES*tag);
+
+	return ~(((x & TAG_LOW_BITS) + TAG_LOW_BITS) | x | TAG_LOW_BITS);
+}
+
+inline unsigned long* probe_set(
+	argument_table_type* t, 
+	u32 set,
+	u16 tag,
+	unsigned long* argument_list,
+	int argument_count
+	) {
+
+	// Pairs with the smp_store_release() in place_in_set().
+	u64 match = match_tags(smp_load_acquire(&t->tags[set]), tag);
+
+	while (match != 0) {
+		u32 way = __ffs(match) >> 4;
+		unsigned long* row = table_row(t, set*ASOS + way);
+
+		if (memcmp(argument_list, row, argument_count*sizeof(unsigned long)) == 0) {
+			u32 bit = set*CLOCK_SET_BITS + way;
+
+			// Only dirty the line the first time the hand finds it clear.
+			if (t->referenced != NULL && !test_bit(bit, t->referenced)) {
+				set_bit(bit, t->referenced);
+			}
+			return row;
+		}
+		match &= match - 1;
+	}
+	return NULL;
+}
+
+/*
+ * Probe the sets a tuple may live in, skipping the ones below from_set
+ * (already migrated out of an old table). The cuckoo backend looks at two
+ * sets at most, plus the stash when anything overflowed into it. Returns
+ * the row holding the tuple, or NULL.
+ */
+inline unsigned long* probe_table(
+	argument_table_type* t,
+	u32 hash_code,
+	unsigned long* argument_list,
+	int argument_count,
+	u32 from_set
+	) {
+
+	u32 set = first_set(t, hash_code);
+	u16 tag = tag_of(t, hash_code);
+	unsigned long* row = NULL;
+	int stash_count;
+	int index;
+
+	if (set >= from_set) {
+		row = probe_set(t, set, tag, argument_list, argument_count);
+	}
+
+	if (row != NULL || !t->cuckoo) {
+		return row;
+	}
+
+	set = second_set(t, hash_code);
+	if (set >= from_set) {
+		row = probe_set(t, set, tag, argument_list, argument_count);
+	}
+	if (row != NULL) {
+		return row;
+	}
+
+	stash_count = smp_load_acquire(&t->stash_count);
+	for (index = 0; index < stash_count; ++index) {
+		if (t->stash_tag[index] == tag && memcmp(argument_list, t->stash[index], 
+			argument_count*sizeof(unsigned long)) == 0) {
+			return t->stash[index];
+		}
+	}
+	return NULL;
+}
+
+inline int lookup_argument(
+	hash_table_per_process_per_syscall_type* sys,
+	u32 hash_code,
+	unsigned long* argument_list,
+	int argument_count,
+	u32* verdict
+	) {
+
+	unsigned int seq = read_seqcount_begin(&sys->seq);
+	argument_table_type* t;
+	unsigned long* row;
+
+	// No tuple has needed a hash table yet, nor been migrated out of one.
+	t = rcu_dereference(sys->active);
+	if (t == NULL) {
+		return 0;
+	}
+	row = probe_table(t, hash_code, argument_list, argument_count, 0);
+
+	// While resizing, sets of the old table below the cursor are already moved.
+	if (row == NULL) {
+		t = rcu_dereference(sys->old);
+		if (t != NULL) {
+			row = probe_table(t, hash_code, argument_list, 
+				argument_count, smp_load_acquire(&sys->migrate_cursor));
+		}
+	}
+	if (row == NULL) {
+		return 0;
+	}
+	*verdict = READ_ONCE(row[argument_count]);
+
+	// A row may have been compared while it was being displaced, only
+	// trust the hit if nothing was displaced meanwhile.
+	return !read_seqcount_retry(&sys->seq, seq);
+}
+
+static inline int place_in_set(
+	argument_table_type* t, 
+	u32 set,
+	u16 tag,
+	unsigned long* argument_list,
+	int argument_count
+	) {
+
+	u32 entry_position = set*ASOS;
+	int index;
+
+	for (index = 0; index < ASOS; ++index) {
+		u16* lane = tag_lane(t, entry_position+index);
+
+		if (READ_ONCE(*lane) == TAG_EMPTY && 
+			cmpxchg(lane, TAG_EMPTY, TAG_BUSY) == TAG_EMPTY) {
+			memcpy(table_row(t, entry_position+index), argument_list, 
+				ROW_WORDS(argument_count)*sizeof(unsigned long));
+			smp_store_release(lane, tag);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Both sets are full: move a resident tuple to its other set to make room,
+ * following the chain for at most CUCKOO_MAX_KICKS steps. Whatever is
+ * still homeless at the end goes to the stash, or is dropped. Called with
+ * sys->lock held; ways still being filled by a lock-free insert are never
+ * picked as victims.
+ */
+int cuckoo_kick(
+	hash_table_per_process_per_syscall_type* sys,
+	argument_table_type* t, 
+	u32 hash_code,
+	unsigned long* argument_list,
+	int argument_count
+	) {
+
+	unsigned long carry[ROW_WORDS(MAX_ARGUMENT_COUNT)];
+	unsigned long victim[ROW_WORDS(MAX_ARGUMENT_COUNT)];
+	size_t length = ROW_WORDS(argument_count)*sizeof(unsigned long);
+	u32 set = first_set(t, hash_code);
+	u16 carry_tag = tag_of(t, hash_code);
+	int kick;
+
+	memcpy(carry, argument_list, length);
+
+	for (kick = 0; kick < CUCKOO_MAX_KICKS; ++kick) {
+		unsigned long* row = NULL;
+		u16* lane = NULL;
+		u16 victim_tag = TAG_EMPTY;
+		u32 victim_hash;
+		int way;
+
+		for (way = 0; way < ASOS && row == NULL; ++way) {
+			u32 position = set*ASOS + t->kick_way;
+
+			t->kick_way = (t->kick_way + 1) % ASOS;
+			lane = tag_lane(t, position);
+			victim_tag = smp_load_acquire(lane);
+			if (victim_tag >= TAG_FIRST) {
+				row = table_row(t, position);
+			}
+		}
+		if (row == NULL) {
+			break;
+		}
+
+		memcpy(victim, row, length);
+		write_seqcount_begin(&sys->seq);
+		memcpy(row, carry, length);
+		WRITE_ONCE(*lane, carry_tag);
+		write_seqcount_end(&sys->seq);
+		memcpy(carry, victim, length);
+		carry_tag = victim_tag;
+
+		victim_hash = hash_arguments(carry, argument_count);
+		set = (set == first_set(t, victim_hash)) ? 
+			second_set(t, victim_hash) : first_set(t, victim_hash);
+
+		if (place_in_set(t, set, carry_tag, carry, argument_count)) {
+			return 1;
+		}
+	}
+
+	if (t->stash_count < CUCKOO_STASH_SIZE) {
+		memcpy(t->stash[t->stash_count], carry, length);
+		t->stash_tag[t->stash_count] = carry_tag;
+		// Pairs with the smp_load_acquire() in probe_table().
+		smp_store_release(&t->stash_count, t->stash_count + 1);
+		return 1;
+	}
+
+	return 0;
+}
+
+static inline u32 clock_hand(argument_table_type* t, u32 set) {
+	u32 bit = set*CLOCK_SET_BITS + CLOCK_HAND_BIT;
+
+	return test_bit(bit, t->referenced) | test_bit(bit + 1, t->referenced) << 1;
+}
+
+// Under sys->lock, the only writer of the hand bits.
+static inline void store_clock_hand(argument_table_type* t, u32 set, u32 hand) {
+	u32 bit = set*CLOCK_SET_BITS + CLOCK_HAND_BIT;
+	u32 changed = hand ^ clock_hand(t, set);
+
+	if (changed & 1) {
+		change_bit(bit, t->referenced);
+	}
+	if (changed & 2) {
+		change_bit(bit + 1, t->referenced);
+	}
+}
+
+/*
+ * The set is full: overwrite a resident with the new tuple according to
+ * the replacement policy. Called with sys->lock held, like cuckoo_kick(),
+ * and ways still being filled are never picked. Returns 0 if none could.
+ */
+int replace_argument(
+	hash_table_per_process_per_syscall_type* sys,
+	argument_table_type* t, 
+	u32 hash_code,
+	unsigned long* argument_list,
+	int argument_count
+	) {
+
+	u32 set = first_set(t, hash_code);
+	u32 hand = (t->referenced != NULL) ? clock_hand(t, set) : prandom_u32() % ASOS;
+	u32 position = 0;
+	u16* lane = NULL;
+	int step;
+
+	// Two turns of the hand: a second chance for every way at most.
+	for (step = 0; step < 2*ASOS && lane == NULL; ++step) {
+		u32 way = hand;
+
+		position = set*ASOS + way;
+		hand = (hand + 1) % ASOS;
+
+		if (smp_load_acquire(tag_lane(t, position)) < TAG_FIRST) {
+			continue;
+		}
+		if (t->referenced != NULL && 
+			test_and_clear_bit(set*CLOCK_SET_BITS + way, t->referenced)) {
+			continue;
+		}
+		lane = tag_lane(t, position);
+	}
+	if (t->referenced != NULL) {
+		store_clock_hand(t, set, hand);
+	}
+	if (lane == NULL) {
+		return 0;
+	}
+
+	write_seqcount_begin(&sys->seq);
+	memcpy(table_row(t, position), argument_list, 
+		ROW_WORDS(argument_count)*sizeof(unsigned long));
+	WRITE_ONCE(*lane, tag_of(t, hash_code));
+	write_seqcount_end(&sys->seq);
+	return 1;
+}
+
+/*
+ * Put the tuple in a free way of its set(s), without taking any lock.
+ * Returns 0 when they are full; the set-associative backend then drops
+ * the tuple, the cuckoo backend tries cuckoo_kick() under sys->lock.
+ */
+inline int place_argument(
+	argument_table_type* t, 
+	u32 hash_code,
+	unsigned long* argument_list,
+	int argument_count
+	) {
+
+	u16 tag = tag_of(t, hash_code);
+
+	if (place_in_set(t, first_set(t, hash_code), tag, argument_list, argument_count)) {
+		return 1;
+	}
+
+	if (!t->cuckoo) {
+		return 0;
+	}
+
+	return place_in_set(t, second_set(t, hash_code), tag, argument_list, argument_count);
+}
+
+void grow_work_handler(struct work_struct* work) {
+	hash_table_per_process_per_syscall_type* sys = container_of(
+		work, hash_table_per_process_per_syscall_type, grow_work);
+	argument_table_type* active;
+	argument_table_type* grown;
+	struct mem_cgroup* memcg;
+	u32 size;
+	
+	// No table is swapped in while grow_pending is set and grown is NULL.
+	active = rcu_dereference_protected(sys->active, 
+		test_bit(GROW_PENDING, &sys->grow_pending));
+	size = test_and_clear_bit(REHOME_PENDING, &sys->grow_pending) ? 
+		active->size : next_argument_table_size(active->size);
+	// Over its cgroup's budget the table just stays as it is.
+	if (!charge_cgroup(sys->cgroup, argument_table_footprint(size, active->argument_count))) {
+		goto fail;
+	}
+	memcg = use_cgroup_memcg(sys->cgroup);
+	grown = alloc_argument_table(size, active->argument_count, 
+		KMALLOC_FLAG, READ_ONCE(sys->node));
+	unuse_cgroup_memcg(sys->cgroup, memcg);
+	if (grown == NULL) {
+		uncharge_cgroup(sys->cgroup, argument_table_footprint(size, active->argument_count));
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:grow_work_handler()]:growing argument table failed....");
+		#endif
+		goto fail;
+	}
+	grown->cgroup = sys->cgroup;
+	WRITE_ONCE(sys->grow_failed_size, 0);
+
+	// Pairs with the smp_load_acquire() in migrate_step().
+	smp_store_release(&sys->grown, grown);
+	return;
+
+fail:
+	// Inserts keep asking for this size; let them only after a while.
+	WRITE_ONCE(sys->grow_retry_after, jiffies + GROW_RETRY_PERIOD);
+	WRITE_ONCE(sys->grow_failed_size, size);
+	clear_bit(GROW_PENDING, &sys->grow_pending);
+}
+
+void maybe_grow(hash_table_per_process_per_syscall_type* sys) {
+	argument_table_type* active = rcu_dereference(sys->active);
+	u32 capacity = active->size*ASOS;
+	u32 conflicts = atomic_read(&sys->conflict_since_resize);
+	u32 samples = atomic_read(&sys->inserted_since_resize) + conflicts;
+	u32 size = next_argument_table_size(active->size);
+
+	if (size == active->size) {
+		return;
+	}
+	if (size == READ_ONCE(sys->grow_failed_size) && 
+		time_before(jiffies, READ_ONCE(sys->grow_retry_after))) {
+		return;
+	}
+
+	if (atomic_read(&sys->occupied)*100 < capacity*(active->cuckoo ? 
+			CUCKOO_GROW_LOAD_PERCENT : GROW_LOAD_PERCENT) &&
+		(samples < GROW_MIN_SAMPLES || 
+		conflicts*100 < samples*GROW_CONFLICT_PERCENT)) {
+		return;
+	}
+
+	if (!test_and_set_bit(GROW_PENDING, &sys->grow_pending)) {
+		queue_work(hash_table.workqueue, &sys->grow_work);
+	}
+}
+
+/*
+ * Count a lookup in this CPU's window of @sys, with "numa_rehome" set. A
+ * full window is added to the counts of @sys; the CPU whose window brings
+ * them to REHOME_SAMPLES starts them over and, if it is remote and remote
+ * lookups dominated, moves the tables to its node. Two CPUs racing there
+ * merely lose a window.
+ */
+void sample_node(hash_table_type* hash_table, hash_table_per_process_per_syscall_type* sys, int remote) {
+	sample_window_type* window;
+	unsigned int local_calls = 0;
+	unsigned int remote_calls = 0;
+
+	window = get_cpu_ptr(sys->window);
+	if (remote) {
+		window->remote++;
+	} else {
+		window->local++;
+	}
+	if (window->local + window->remote >= REHOME_WINDOW) {
+		local_calls = window->local;
+		remote_calls = window->remote;
+		window->local = 0;
+		window->remote = 0;
+	}
+	put_cpu_ptr(sys->window);
+	if (local_calls + remote_calls == 0) {
+		return;
+	}
+
+	local_calls = atomic_add_return(local_calls, &sys->rehome_local);
+	remote_calls = atomic_add_return(remote_calls, &sys->rehome_remote);
+	if (local_calls + remote_calls < REHOME_SAMPLES) {
+		return;
+	}
+	atomic_set(&sys->rehome_local, 0);
+	atomic_set(&sys->rehome_remote, 0);
+	if (remote && remote_calls >= REHOME_RATIO*local_calls) {
+		maybe_rehome(hash_table, sys);
+	}
+}
+
+/*
+ * Called from sample_node() on a CPU whose node is not the one the
+ * argument tables of @sys are allocated on. A table being grown or
+ * rehomed already is left alone. Only the argument table moves: @sys
+ * itself, direct_allowed included, is a few lines that lookups mostly read
+ * and every node's cache keeps a copy of, and each CPU's sample window is
+ * per-CPU memory, on that CPU's node already.
+ */
+void maybe_rehome(hash_table_type* hash_table, hash_table_per_process_per_syscall_type* sys) {
+	unsigned long after = READ_ONCE(sys->rehome_after);
+	int node = numa_node_id();
+
+	if (after != 0 && time_before(jiffies, after)) {
+		return;
+	}
+	if (test_and_set_bit(GROW_PENDING, &sys->grow_pending)) {
+		return;
+	}
+
+	WRITE_ONCE(sys->rehome_after, jiffies + REHOME_PERIOD);
+	WRITE_ONCE(sys->node, node);
+	#ifdef METRICS_DRACO
+		this_cpu_inc(hash_table->metrics->total_rehome_count);
+	#endif
+
+	// Only the direct bitmap so far, the first table is allocated there.
+	if (rcu_access_pointer(sys->active) == NULL) {
+		clear_bit(GROW_PENDING, &sys->grow_pending);
+		return;
+	}
+	set_bit(REHOME_PENDING, &sys->grow_pending);
+	queue_work(hash_table->workqueue, &sys->grow_work);
+}
+
+static void migrate_row(
+	hash_table_per_process_per_syscall_type* sys,
+	argument_table_type* active,
+	unsigned long* row,
+	int argument_count
+	) {
+
+	u32 hash_code = hash_arguments(row, argument_count);
+
+	if (place_argument(active, hash_code, row, argument_count)) {
+		return;
+	}
+	if (active->cuckoo && cuckoo_kick(sys, active, hash_code, row, argument_count)) {
+		return;
+	}
+	atomic_dec(&sys->occupied);
+}
+
+/*
+ * Swap in a table prepared by grow_work and move a few sets of the
+ * previous one on every call, so no single syscall pays for the whole
+ * rehash. Any thread of the group may do it; if another one already
+ * holds sys->lock this one just goes on with its lookup. The old table is
+ * freed after a grace period, lookups may still be walking it.
+ */
+void migrate_step(hash_table_per_process_per_syscall_type* sys, int argument_count) {
+	argument_table_type* active;
+	argument_table_type* old;
+	argument_table_type* grown;
+	u32 cursor, end;
+	int index;
+
+	if (!spin_trylock(&sys->lock)) {
+		return;
+	}
+
+	active = rcu_dereference_protected(sys->active, lockdep_is_held(&sys->lock));
+	old = rcu_dereference_protected(sys->old, lockdep_is_held(&sys->lock));
+
+	if (old == NULL) {
+		grown = smp_load_acquire(&sys->grown);
+		if (grown == NULL) {
+			goto out;
+		}
+
+		// Publish old first so that a lookup always finds one of the two.
+		sys->grown = NULL;
+		sys->migrate_cursor = 0;
+		old = active;
+		active = grown;
+		rcu_assign_pointer(sys->old, old);
+		rcu_assign_pointer(sys->active, active);
+
+		// The stash is not covered by the cursor, move it right away.
+		for (index = 0; index < old->stash_count; ++index) {
+			migrate_row(sys, active, old->stash[index], argument_count);
+		}
+	}
+
+	cursor = sys->migrate_cursor;
+	end = min_t(u32, cursor + MIGRATE_STEP, old->size);
+	for (; cursor < end; ++cursor) {
+		u32 entry_position = cursor*ASOS;
+		
+		// A way still being filled through a stale pointer to old is lost.
+		for (index = 0; index < ASOS; ++index) {
+			u16 tag = smp_load_acquire(tag_lane(old, entry_position+index));
+
+			if (tag == TAG_EMPTY) {
+				break;
+			}
+			if (tag >= TAG_FIRST) {
+				migrate_row(sys, active, table_row(old, entry_position+index), argument_count);
+			}
+		}
+	}
+	// Pairs with the smp_load_acquire() in lookup_argument().
+	smp_store_release(&sys->migrate_cursor, cursor);
+
+	if (cursor == old->size) {
+		RCU_INIT_POINTER(sys->old, NULL);
+		// Uncharged now, its cache and cgroup may be gone after the grace period.
+		uncharge_cgroup(old->cgroup, argument_table_footprint(old->size, old->argument_count));
+		old->cgroup = NULL;
+		call_rcu(&old->rcu, release_argument_table_rcu);
+		atomic_set(&sys->inserted_since_resize, 0);
+		atomic_set(&sys->conflict_since_resize, 0);
+		clear_bit(GROW_PENDING, &sys->grow_pending);
+	}
+
+out:
+	spin_unlock(&sys->lock);
+}
+
+int bypassing(hash_table_per_process_per_syscall_type* sys) {
+	unsigned long until = READ_ONCE(sys->bypass_until);
+
+	return until != 0 && time_before(jiffies, until);
+}
+
+/*
+ * Count a call in this CPU's window of the syscall and, once the window is
+ * full, stop caching the syscall for a while if too few of its calls hit.
+ * The shared fields are only written at the end of a window; two CPUs
+ * racing there merely pick one of two close deadlines.
+ */
+void sample_hit_rate(hash_table_per_process_per_syscall_type* sys, int hit) {
+	sample_window_type* window;
+	int threshold = READ_ONCE(bypass_hit_percent);
+	uint8_t shift;
+
+	if (threshold <= 0) {
+		return;
+	}
+
+	window = get_cpu_ptr(sys->window);
+	window->calls++;
+	window->hits += hit;
+	if (window->calls >= BYPASS_WINDOW) {
+		shift = READ_ONCE(sys->bypass_shift);
+		if (window->hits*100 < threshold*window->calls) {
+			WRITE_ONCE(sys->bypass_until, jiffies + (BYPASS_PERIOD << shift));
+			if (shift < BYPASS_MAX_SHIFT) {
+				WRITE_ONCE(sys->bypass_shift, shift + 1);
+			}
+		} else if (shift != 0) {
+			WRITE_ONCE(sys->bypass_shift, 0);
+		}
+		window->calls = 0;
+		window->hits = 0;
+	}
+	put_cpu_ptr(sys->window);
+}
+
+/*
+ * A syscall whose verdict does not depend on its arguments is a single bit
+ * and its verdict. Returns 1 and the verdict if this cache, or one it
+ * inherited from, has seen it already.
+ */
+int lookup_argument_free(hash_table_per_process_type* per_process, int syscall, u32* verdict) {
+	hash_table_per_process_type* cache;
+
+	for (cache = per_process; cache != NULL; cache = cache->inherited) {
+		if (test_bit(syscall, cache->argument_free_syscalls)) {
+			// Pairs with the smp_wmb() in record_argument_free().
+			smp_rmb();
+			*verdict = READ_ONCE(cache->argument_free_verdicts[syscall]);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+void record_argument_free(hash_table_per_process_type* per_process, int syscall, u32 verdict) {
+	WRITE_ONCE(per_process->argument_free_verdicts[syscall], verdict);
+	smp_wmb();
+	set_bit(syscall, per_process->argument_free_syscalls);
+}
+
+/*
+ * The cache current looks up and records verdicts in: the one it shares
+ * with its group, or a new one if it has none built for its filter and
+ * configuration yet. NULL if one could not be allocated.
+ */
+hash_table_per_process_type* current_process_table(hash_table_type* hash_table) {
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_type* allocated_process;
+	draco_cgroup_type* cgroup;
+
+	#ifdef DEBUG_DRACO
+		int index;
+		int syscall;
+		int j;
+	#endif	
+
+	per_process = current->seccomp.draco_hook;
+	if (likely(per_process != NULL && built_for(per_process, &current->seccomp))) {
+		return per_process;
+	}
+
+	if (per_process != NULL) {
+		// This thread installed a filter or configuration of its own, the
+		// shared tuples were not checked against it.
+		release_process_table(hash_table, current);
+	}
+
+	per_process = group_process_table();
+	if (per_process != NULL) {
+		rcu_read_lock();
+		put_process_table(hash_table, xchg(&current->seccomp.draco_parent, NULL));
+		rcu_read_unlock();
+		current->seccomp.draco_hook = per_process;
+		return per_process;
+	}
+
+	#ifdef DEBUG_DRACO
+		printk("[Draco:current_process_table()]:" 
+			"Begin allocating the space for the new process");
+		printk("[Draco:current_process_table()]:Print profile info, totally %d syscalls\n", current->seccomp.draco_count);
+		
+		for (index = 0; index < current->seccomp.draco_count; ++index) {
+			syscall = current->seccomp.bit_map[index];
+			printk("syscall=%d:", syscall);
+			for (j = 0; j < current->seccomp.argument_count_table[syscall]; ++j) {
+				printk("%d", current->seccomp.sys2arguments[syscall][j]);
+			}
+			printk("\n");
+		}
+	#endif
+	if (cgroup_denied()) {
+		return NULL;
+	}
+	cgroup = get_cgroup();
+	if (unlikely(cgroup == NULL)) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:current_process_table()]:get_cgroup failed....");
+		#endif
+		return NULL;
+	}
+	// A cgroup over its budget runs its syscalls through the filter alone.
+	if (!charge_cgroup(cgroup, sizeof(hash_table_per_process_type))) {
+		WRITE_ONCE(cgroup->denied_until, jiffies + CGROUP_DENY_PERIOD);
+		put_cgroup(cgroup);
+		return NULL;
+	}
+
+	//Allocate the space for current->draco_hook
+	allocated_process = (hash_table_per_process_type*) kmem_cache_alloc_node(
+		hash_table->process_table_cache, KMALLOC_FLAG | __GFP_ZERO, numa_node_id());
+	
+	if (unlikely(allocated_process == NULL)) {
+
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING 
+				"[Draco:current_process_table()]:allocated_process kmem_cache_alloc_node failed....");
+		#endif
+
+		uncharge_cgroup(cgroup, sizeof(hash_table_per_process_type));
+		put_cgroup(cgroup);
+		return NULL;
+	}
+
+	allocated_process->cgroup = cgroup;
+	allocated_process->node = numa_node_id();
+	allocated_process->filter = current->seccomp.filter;
+	allocated_process->generation = current->seccomp.draco_generation;
+	atomic_set(&allocated_process->users, 1);
+	INIT_WORK(&allocated_process->free_work, free_process_table_work);
+
+	#ifdef METRICS_DRACO
+		allocated_process->metrics = alloc_percpu(per_process_metrics_type);
+		if (unlikely(allocated_process->metrics == NULL)) {
+			#ifdef ALERT_DRACO
+				printk (KERN_WARNING 
+					"[Draco:current_process_table()]:per-process metrics alloc_percpu failed....");
+			#endif
+			uncharge_cgroup(cgroup, sizeof(hash_table_per_process_type));
+			put_cgroup(cgroup);
+			kmem_cache_free(hash_table->process_table_cache, allocated_process);
+			return NULL;
+		}
+		allocated_process->process_id = current->tgid;
+		this_cpu_inc(hash_table->metrics->total_process_count);
+	#endif
+
+	// Everything above was allocated without holding any lock; only the
+	// shard of this CPU is locked, to link the cache in.
+	allocated_process->inherited = xchg(&current->seccomp.draco_parent, NULL);
+	if (allocated_process->inherited != NULL && 
+		!built_for(allocated_process->inherited, &current->seccomp)) {
+		rcu_read_lock();
+		put_process_table(hash_table, allocated_process->inherited);
+		rcu_read_unlock();
+		allocated_process->inherited = NULL;
+	}
+	register_process_table(hash_table, allocated_process);
+	publish_process_table(allocated_process);
+	current->seccomp.draco_hook = allocated_process;
+	return allocated_process;
+}
+
+// Fill in argument, as far as the filter tells values apart.
+int fill_arguments(key_type* key) {
+	int argument_count = current->seccomp.argument_count_table[key->syscall_id];
+	uint8_t* argument_positions = current->seccomp.sys2arguments[key->syscall_id];
+	int index;
+
+	for (index = 0; index < argument_count; ++index) {
+		key->argument_list[index] = canonical_argument(current->seccomp.draco_config, 
+			key->syscall_id, argument_positions[index],
+			get_argument(key->regs, argument_positions[index]));
+	}
+	return argument_count;
+}
+
+static inline int direct_value(unsigned long* argument_list, int argument_count) {
+	return argument_count == 1 && argument_list[0] < DIRECT_VALUES;
+}
+
+/*
+ * Look the arguments filled in @key up in one syscall table: a bit test
+ * for a small single argument the filter allowed, else hash and probe.
+ */
+int lookup_syscall(
+	hash_table_per_process_per_syscall_type* sys,
+	key_type* key,
+	int argument_count,
+	u32* verdict
+	) {
+
+	u32 hash_code;
+	int found;
+
+	if (direct_value(key->argument_list, argument_count) && 
+		test_bit(key->argument_list[0], sys->direct_allowed)) {
+		*verdict = SECCOMP_RET_ALLOW;
+		return 1;
+	}
+
+	hash_code = hash_arguments(key->argument_list, argument_count);
+
+	#ifdef DEBUG_DRACO
+		printk (KERN_DEBUG "[Draco:lookup_syscall()]:hash_code=%d\n", hash_code);
+	#endif
+
+	rcu_read_lock();
+	found = lookup_argument(sys, hash_code, key->argument_list, argument_count, verdict);
+	rcu_read_unlock();
+	return found;
+}
+
+/*
+ * Remember @verdict for the arguments filled in @key in @per_syscall: a
+ * bit for a small single argument the filter allowed, else a row of its
+ * argument table.
+ */
+static void record_argument(
+	hash_table_type* hash_table, 
+	hash_table_per_process_type* per_process,
+	hash_table_per_process_per_syscall_type* per_syscall,
+	key_type* key,
+	int argument_count,
+	u32 verdict
+	) {
+
+	u32 hash_code;
+	u32 cached;
+	argument_table_type* active;
+	int inserted;
+
+	if (direct_value(key->argument_list, argument_count) && verdict == SECCOMP_RET_ALLOW) {
+		if (!test_bit(key->argument_list[0], per_syscall->direct_allowed)) {
+			set_bit(key->argument_list[0], per_syscall->direct_allowed);
+		}
+		return;
+	}
+
+	if (!install_argument_table(per_syscall)) {
+		return;
+	}
+	key->argument_list[argument_count] = verdict;
+	hash_code = hash_arguments(key->argument_list, argument_count);
+
+	rcu_read_lock();
+
+	// Another thread of the group may have recorded it while the filter ran.
+	if (lookup_argument(per_syscall, hash_code, key->argument_list, argument_count, &cached)) {
+		rcu_read_unlock();
+		return;
+	}
+
+	// New entry, Insert
+	active = rcu_dereference(per_syscall->active);
+	inserted = place_argument(active, hash_code, key->argument_list, argument_count);
+	if (!inserted && active->cuckoo) {
+		spin_lock(&per_syscall->lock);
+		active = rcu_dereference_protected(per_syscall->active, 
+			lockdep_is_held(&per_syscall->lock));
+		inserted = cuckoo_kick(per_syscall, active, hash_code, 
+			key->argument_list, argument_count);
+		spin_unlock(&per_syscall->lock);
+	}
+
+	if (inserted) {
+		atomic_inc(&per_syscall->occupied);
+		atomic_inc(&per_syscall->inserted_since_resize);
+		maybe_grow(per_syscall);
+		rcu_read_unlock();
+		return;
+	}
+
+	// The set is full, evict a resident for it if so configured.
+	if (!active->cuckoo && replacement != REPLACE_NONE) {
+		spin_lock(&per_syscall->lock);
+		active = rcu_dereference_protected(per_syscall->active, 
+			lockdep_is_held(&per_syscall->lock));
+		replace_argument(per_syscall, active, hash_code, 
+			key->argument_list, argument_count);
+		spin_unlock(&per_syscall->lock);
+	}
+
+	/// Conflict Discard or evict, a bigger table will take both next time.
+	atomic_inc(&per_syscall->conflict_since_resize);
+	maybe_grow(per_syscall);
+	rcu_read_unlock();
+
+	#ifdef METRICS_DRACO
+		this_cpu_inc(hash_table->metrics->total_conflict_count);
+		this_cpu_inc(per_process->metrics->per_process_conflict_count);
+		this_cpu_inc(per_process->cgroup->metrics->per_cgroup_conflict_count);
+		this_cpu_inc(per_syscall->metrics->per_syscall_conflict_count);
+	#endif
+}
+
+/*
+ * Called before the filter runs: returns 1 and the verdict the filter gave
+ * this syscall and arguments before, or 0 if the filter has to run.
+ */
+int lookup_value(
+	hash_table_type* hash_table, 
+	key_type* key,
+	u32* verdict
+	) {
+	
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_per_syscall_type* per_syscall;
+	int argument_count;	
+	int found = 0;
+	int remote;
+
+	if (hash_table == NULL) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:lookup_value()]:initialization failed, don't use it....");
+		#endif
+		return 0;
+	}
+
+	#ifdef DEBUG_DRACO
+		printk("[Draco:lookup_value()]: Begin lookup_value()");
+	#endif
+
+	#ifdef METRICS_DRACO
+		this_cpu_inc(hash_table->metrics->total_call_count);
+	#endif
+	
+	per_process = current_process_table(hash_table);
+	if (per_process == NULL) {
+		return 0;
+	}
+
+	#ifdef METRICS_DRACO
+		this_cpu_inc(per_process->metrics->per_process_call_count);
+		this_cpu_inc(per_process->cgroup->metrics->per_cgroup_call_count);
+	#endif
+	
+	argument_count = current->seccomp.argument_count_table[key->syscall_id];
+	per_syscall = READ_ONCE(per_process->syscall_table[key->syscall_id]);
+
+	// Its arguments do not repeat, go to the filter without hashing them.
+	if (per_syscall != NULL && bypassing(per_syscall)) {
+		#ifdef METRICS_DRACO
+			this_cpu_inc(hash_table->metrics->total_bypass_count);
+		#endif
+		return 0;
+	}
+
+	if (argument_count == 0) {
+		// No argument to check: a bit test, no hashing and no table.
+		found = lookup_argument_free(per_process, key->syscall_id, verdict);
+	} else if (per_syscall == NULL) {
+		// A forked child reads what its ancestors learned until it misses.
+		if (per_process->inherited != NULL) {
+			fill_arguments(key);
+			found = lookup_inherited(per_process, key, argument_count, verdict);
+		}
+	} else if (likely(per_syscall->argument_count == argument_count)) {
+		// Rows are only as wide as the configuration the table was built for.
+		fill_arguments(key);
+
+		#ifdef METRICS_DRACO
+			this_cpu_inc(per_syscall->metrics->per_syscall_call_count);
+		#endif
+
+		if (rcu_access_pointer(per_syscall->old) != NULL || READ_ONCE(per_syscall->grown) != NULL) {
+			rcu_read_lock();
+			migrate_step(per_syscall, argument_count);
+			rcu_read_unlock();
+		}
+		found = lookup_syscall(per_syscall, key, argument_count, verdict);
+
+		// What the ancestors learned is copied over one tuple at a time, on use.
+		if (!found && per_process->inherited != NULL && 
+			lookup_inherited(per_process, key, argument_count, verdict)) {
+			record_argument(hash_table, per_process, per_syscall, key, argument_count, *verdict);
+			found = 1;
+		}
+
+		sample_hit_rate(per_syscall, found);
+
+		remote = numa_node_id() != READ_ONCE(per_syscall->node);
+		#ifdef METRICS_DRACO
+			if (unlikely(remote)) {
+				this_cpu_inc(hash_table->metrics->total_remote_call_count);
+			} else {
+				this_cpu_inc(hash_table->metrics->total_local_call_count);
+			}
+		#endif
+		if (READ_ONCE(numa_rehome)) {
+			sample_node(hash_table, per_syscall, remote);
+		}
+
+		#ifdef METRICS_DRACO
+			if (!found) {
+				this_cpu_inc(per_syscall->metrics->per_syscall_argument_count);
+			}
+		#endif
+	}
+
+	if (found) {
+		// Hit it.
+		#ifdef DEBUG_DRACO
+			printk("[Draco:lookup_value()]: hit !!");
+		#endif
+
+		#ifdef METRICS_DRACO
+			this_cpu_inc(hash_table->metrics->total_hit_count);
+			this_cpu_inc(per_process->cgroup->metrics->per_cgroup_hit_count);
+		#endif
+		
+		return 1;
+	}
+
+	#ifdef DEBUG_DRACO
+		printk("[Draco:lookup_value()]: No hit~");
+	#endif
+
+	#ifdef METRICS_DRACO
+		this_cpu_inc(per_process->metrics->per_process_argument_count);
+		this_cpu_inc(per_process->cgroup->metrics->per_cgroup_argument_count);
+		this_cpu_inc(hash_table->metrics->total_argument_count);
+	#endif
+
+	return 0;
+}
+
+/*
+ * Called after the filter ran on a miss of lookup_value(): remember its
+ * verdict for the syscall and arguments, whatever it was.
+ */
+void insert_value(
+	hash_table_type* hash_table, 
+	key_type* key,
+	u32 verdict
+	) {
+	
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_per_syscall_type** sys_table;	
+	hash_table_per_process_per_syscall_type* per_syscall;
+	int argument_count;	
+
+	if (hash_table == NULL) {
+		return;
+	}
+
+	// lookup_value() set it up for this filter and configuration, if it could.
+	per_process = current->seccomp.draco_hook;
+	if (per_process == NULL || unlikely(!built_for(per_process, &current->seccomp))) {
+		return;
+	}
+
+	argument_count = current->seccomp.argument_count_table[key->syscall_id];
+	sys_table = per_process->syscall_table;
+	per_syscall = READ_ONCE(sys_table[key->syscall_id]);
+
+	if (per_syscall != NULL && bypassing(per_syscall)) {
+		return;
+	}
+
+	if (argument_count == 0) {
+		record_argument_free(per_process, key->syscall_id, verdict);
+		return;
+	}
+
+	fill_arguments(key);
+
+	if (per_syscall == NULL) {
+		hash_table_per_process_per_syscall_type* allocated_syscall;
+
+		#ifdef DEBUG_DRACO
+			printk("[Draco:insert_value()]:allocate the space for a new syscall");
+		#endif
+		if (!charge_cgroup(per_process->cgroup, sizeof(*allocated_syscall))) {
+			return;
+		}
+		allocated_syscall = alloc_syscall_table(hash_table, initial_argument_table_size(), argument_count, 
+			numa_node_id(), per_process->cgroup);
+		
+		if (allocated_syscall == NULL) {
+			
+			uncharge_cgroup(per_process->cgroup, sizeof(*allocated_syscall));
+			#ifdef ALERT_DRACO
+				printk (KERN_WARNING "allocating agument_table failed....");
+			#endif
+			
+			return;
+		}
+
+		// Another thread of the group may have installed one meanwhile.
+		per_syscall = cmpxchg(&sys_table[key->syscall_id], NULL, allocated_syscall);
+		if (per_syscall != NULL) {
+			free_syscall_table(hash_table, allocated_syscall);
+		} else {
+			per_syscall = allocated_syscall;
+			#ifdef METRICS_DRACO
+				this_cpu_inc(per_process->metrics->per_process_syscall_count);
+			#endif
+		}
+	}
+
+	// Rows are only as wide as the configuration the table was built for.
+	if (unlikely(per_syscall->argument_count != argument_count)) {
+		return;
+	}
+
+	record_argument(hash_table, per_process, per_syscall, key, argument_count, verdict);
+}
+
+void free_hash_table(hash_table_type* hash_table) {
+	struct task_struct* group;
+	struct task_struct* thread;
+	hash_table_per_process_type* per_process;
+	registry_shard_type* shard;
+	struct hlist_node* next;
+	int cpu;
+	#ifdef METRICS_DRACO
+		int node;
+	#endif
+	LIST_HEAD(dead);
+	
+	#ifdef METRICS_DRACO
+		printk(KERN_INFO "[Draco:free_hash_table]:\n"
+			"total_hit_count = %llu\n" 
+			"total_call_count =%llu\n"
+			"total_argument_count = %llu\n"
+			"total_conflict_count = %llu\n"
+			"total_syscall_count = %llu\n"
+			"total_process_count = %llu\n"
+			"total_bypass_count = %llu\n\n",
+			METRICS_SUM(hash_table->metrics, total_hit_count), 
+			METRICS_SUM(hash_table->metrics, total_call_count),
+			METRICS_SUM(hash_table->metrics, total_argument_count),
+			METRICS_SUM(hash_table->metrics, total_conflict_count),
+			METRICS_SUM(hash_table->metrics, total_syscall_count),
+			METRICS_SUM(hash_table->metrics, total_process_count),
+			METRICS_SUM(hash_table->metrics, total_bypass_count)
+		);
+		for_each_online_node(node) {
+			printk(KERN_INFO "[Draco:free_hash_table]:node %d:\n"
+				"process_count = %llu\n"
+				"local_call_count = %llu\n"
+				"remote_call_count = %llu\n"
+				"rehome_count = %llu\n\n",
+				node,
+				METRICS_NODE_SUM(hash_table->metrics, total_process_count, node),
+				METRICS_NODE_SUM(hash_table->metrics, total_local_call_count, node),
+				METRICS_NODE_SUM(hash_table->metrics, total_remote_call_count, node),
+				METRICS_NODE_SUM(hash_table->metrics, total_rehome_count, node)
+			);
+		}
+	#endif
+
+	// Deattach every task_struct; a cache nobody refers to any more, e.g.
+	// after a fork that failed past draco_fork, is freed all the same.
+	rcu_read_lock();
+	do_each_thread(group, thread) {
+		xchg(&thread->seccomp.draco_hook, NULL);
+		xchg(&thread->seccomp.draco_parent, NULL);
+	} while_each_thread(group, thread);
+	rcu_read_unlock();
+
+	for_each_possible_cpu(cpu) {
+		shard = per_cpu_ptr(hash_table->registry, cpu);
+		spin_lock(&shard->lock);
+		hlist_for_each_entry_safe(per_process, next, &shard->head, registry) {
+			hlist_del_init_rcu(&per_process->registry);
+			list_add(&per_process->list, &dead);
+		}
+		spin_unlock(&shard->lock);
+	}
+	list_for_each_entry(per_process, &dead, list) {
+		unpublish_process_table(per_process);
+	}
+
+	// A task exiting meanwhile may still be walking its inherited chain.
+	synchronize_rcu();
+	free_dead_process_tables(hash_table, &dead);
+
+	// Old argument tables and caches still waiting for their grace period,
+	// then the caches handed to a work item by it, then the draco_cgroups
+	// those dropped last.
+	rcu_barrier();
+	flush_workqueue(hash_table->workqueue);
+	rcu_barrier();
+	destroy_workqueue(hash_table->workqueue);
+
+	kmem_cache_destroy(hash_table->syscall_table_cache);
+	kmem_cache_destroy(hash_table->process_table_cache);
+
+	free_percpu(hash_table->registry);
+	#ifdef METRICS_DRACO
+		free_percpu(hash_table->metrics);
+	#endif
+
+	printk(KERN_INFO "Finish the draco free..............\n");
+}
+
+#ifdef LATENCY_DRACO
+static DEFINE_PER_CPU(latency_histogram_type*, latency_histogram);
+static DEFINE_PER_CPU(latency_stamp_type, latency_stamp);
+
+// Histograms are too large for alloc_percpu(), each CPU's is on its node.
+int init_latency(void) {
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		per_cpu(latency_histogram, cpu) = vzalloc_node(sizeof(latency_histogram_type), 
+			cpu_to_node(cpu));
+		if (per_cpu(latency_histogram, cpu) == NULL) {
+			#ifdef ALERT_DRACO
+				printk (KERN_WARNING "[Draco:init_latency()]:histogram vzalloc_node failed....");
+			#endif
+			free_latency();
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+void free_latency(void) {
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		vfree(per_cpu(latency_histogram, cpu));
+		per_cpu(latency_histogram, cpu) = NULL;
+	}
+}
+
+void record_latency(int syscall, enum latency_kind kind, cycles_t start) {
+	u64 cycles = get_cycles() - start;
+	latency_histogram_type* histogram;
+
+	histogram = get_cpu_var(latency_histogram);
+	histogram->count[syscall][kind][min_t(int, fls64(cycles), LATENCY_BUCKETS - 1)]++;
+	put_cpu_var(latency_histogram);
+}
+
+static void start_filter_latency(int syscall) {
+	latency_stamp_type* stamp = &get_cpu_var(latency_stamp);
+
+	stamp->task = current;
+	stamp->syscall = syscall;
+	stamp->start = get_cycles();
+	put_cpu_var(latency_stamp);
+}
+
+static void finish_filter_latency(int syscall) {
+	latency_stamp_type* stamp = &get_cpu_var(latency_stamp);
+	cycles_t start = stamp->start;
+	int ours = (stamp->task == current && stamp->syscall == syscall);
+
+	stamp->task = NULL;
+	put_cpu_var(latency_stamp);
+	if (ours) {
+		record_latency(syscall, LATENCY_FILTER, start);
+	}
+}
+
+static const char* const latency_kind_names[LATENCY_KINDS] = {
+	"hit", "miss", "filter", "insert"
+};
+
+static u64 latency_sum(int syscall, int kind, int bucket) {
+	u64 sum = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		sum += per_cpu(latency_histogram, cpu)->count[syscall][kind][bucket];
+	}
+	return sum;
+}
+
+// One record per syscall, those never timed are skipped.
+static int latency_timed(int syscall) {
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		if (memchr_inv(per_cpu(latency_histogram, cpu)->count[syscall], 0, 
+			sizeof(per_cpu(latency_histogram, cpu)->count[syscall]))) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// Records are numbered syscall + 1, since a NULL one ends the walk.
+static void* latency_seq_at(loff_t* position) {
+	int syscall;
+
+	for (syscall = *position; syscall < SYSCALL_COUNT; ++syscall) {
+		if (latency_timed(syscall)) {
+			*position = syscall;
+			return (void* )(long)(syscall + 1);
+		}
+	}
+	*position = SYSCALL_COUNT;
+	return NULL;
+}
+
+static void* latency_seq_start(struct seq_file* m, loff_t* position) {
+	return latency_seq_at(position);
+}
+
+static void* latency_seq_next(struct seq_file* m, void* v, loff_t* position) {
+	++*position;
+	return latency_seq_at(position);
+}
+
+static void latency_seq_stop(struct seq_file* m, void* v) {
+}
+
+static int latency_seq_show(struct seq_file* m, void* v) {
+	int syscall = (long)v - 1;
+	int kind;
+	int bucket;
+
+	for (kind = 0; kind < LATENCY_KINDS; ++kind) {
+		seq_printf(m, "%d %s", syscall, latency_kind_names[kind]);
+		for (bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+			seq_printf(m, " %llu", latency_sum(syscall, kind, bucket));
+		}
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+static const struct seq_operations latency_seq_ops = {
+	.start = latency_seq_start,
+	.next = latency_seq_next,
+	.stop = latency_seq_stop,
+	.show = latency_seq_show,
+};
+
+static int latency_open(struct inode* inode, struct file* file) {
+	return seq_open(file, &latency_seq_ops);
+}
+
+// A count bumped on another CPU while it is zeroed may survive the reset.
+static ssize_t latency_write(struct file* file, const char __user* buffer, 
+	size_t count, loff_t* position) {
+
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		memset(per_cpu(latency_histogram, cpu), 0, sizeof(latency_histogram_type));
+	}
+	return count;
+}
+
+static const struct file_operations latency_fops = {
+	.owner = THIS_MODULE,
+	.open = latency_open,
+	.read = seq_read,
+	.write = latency_write,
+	.llseek = seq_lseek,
+	.release = seq_release,
+};
+#endif
+
+static DEFINE_MUTEX(export_mutex);
+static struct seccomp_data* export_entries; // vmalloc()ed, under export_mutex.
+static size_t export_count;
+// Of the task being exported, with a reference, under export_mutex.
+static struct seccomp_draco_config* export_config;
+
+/*
+ * A raw argument that canonical_argument() maps to @canonical: the masked
+ * value itself, or the lowest value of the interval it numbers.
+ */
+unsigned long representative_argument(
+	struct seccomp_draco_config* config, int syscall, uint8_t position, unsigned long canonical) {
+
+	struct seccomp_draco_block* block = &config->draco[syscall];
+	int arg = position - 1;
+
+	if (block->cut_count[arg] == 0 || (block->exact & (1 << arg)) || canonical == 0) {
+		return canonical;
+	}
+	canonical = min_t(unsigned long, canonical, block->cut_count[arg]);
+	return config->draco_cuts[block->cut_start[arg] + canonical - 1];
+}
+
+static void export_entry(struct seccomp* seccomp, int syscall, 
+	unsigned long* argument_list, int argument_count) {
+
+	struct seccomp_data* entry;
+	uint8_t position;
+	int index;
+
+	if (export_count == EXPORT_MAX_ENTRIES) {
+		return;
+	}
+	entry = &export_entries[export_count++];
+	memset(entry, 0, sizeof(*entry));
+	entry->nr = syscall;
+	entry->arch = AUDIT_ARCH_X86_64;
+	for (index = 0; index < argument_count; ++index) {
+		position = seccomp->sys2arguments[syscall][index];
+		entry->args[position - 1] = representative_argument(export_config, syscall, 
+			position, argument_list[index]);
+	}
+}
+
+// Under rcu_read_lock(). A row torn by a displacement is exported as is.
+static void export_argument_table(struct seccomp* seccomp, int syscall, 
+	argument_table_type* t, int argument_count) {
+
+	u32 entry_position;
+	int index;
+
+	for (entry_position = 0; entry_position < t->size*ASOS; ++entry_position) {
+		if (smp_load_acquire(tag_lane(t, entry_position)) >= TAG_FIRST) {
+			export_entry(seccomp, syscall, table_row(t, entry_position), argument_count);
+		}
+	}
+	for (index = 0; index < smp_load_acquire(&t->stash_count); ++index) {
+		export_entry(seccomp, syscall, t->stash[index], argument_count);
+	}
+}
+
+static void export_syscall_table(struct seccomp* seccomp, int syscall, 
+	hash_table_per_process_per_syscall_type* sys) {
+
+	argument_table_type* t;
+	unsigned long value;
+
+	for_each_set_bit(value, sys->direct_allowed, DIRECT_VALUES) {
+		export_entry(seccomp, syscall, &value, 1);
+	}
+
+	rcu_read_lock();
+	t = rcu_dereference(sys->active);
+	if (t != NULL) {
+		export_argument_table(seccomp, syscall, t, sys->argument_count);
+	}
+	t = rcu_dereference(sys->old);
+	if (t != NULL) {
+		export_argument_table(seccomp, syscall, t, sys->argument_count);
+	}
+	rcu_read_unlock();
+}
+
+/*
+ * Snapshot what the cache of @task, and the caches it inherited from,
+ * learned into export_entries. Returns -ENOENT if it has no cache built
+ * for its current filter and configuration.
+ */
+int export_task(struct task_struct* task) {
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_type* ancestor;
+	hash_table_per_process_per_syscall_type* sys;
+	struct seccomp* seccomp = &task->seccomp;
+	int argument_count;
+	int syscall;
+	int ret = 0;
+
+	// The cache is freed a grace period after its last reference went.
+	rcu_read_lock();
+	per_process = READ_ONCE(seccomp->draco_hook);
+	if (per_process != NULL && !atomic_inc_not_zero(&per_process->users)) {
+		per_process = NULL;
+	}
+	rcu_read_unlock();
+	if (per_process == NULL) {
+		return -ENOENT;
+	}
+
+	mutex_lock(&export_mutex);
+	// Its prctls may replace it, and free the one this holds.
+	task_lock(task);
+	export_config = seccomp->draco_config;
+	get_seccomp_draco(export_config);
+	task_unlock(task);
+	vfree(export_entries);
+	export_count = 0;
+	export_entries = vmalloc(EXPORT_MAX_ENTRIES*sizeof(*export_entries));
+	if (export_entries == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	if (!built_for(per_process, seccomp)) {
+		ret = -ENOENT;
+		goto out;
+	}
+
+	for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+		argument_count = seccomp->argument_count_table[syscall];
+		if (argument_count == 0) {
+			for (ancestor = per_process; ancestor != NULL; ancestor = ancestor->inherited) {
+				if (test_bit(syscall, ancestor->argument_free_syscalls)) {
+					export_entry(seccomp, syscall, NULL, 0);
+					break;
+				}
+			}
+			continue;
+		}
+
+		// A tuple copied over from an ancestor is exported once more.
+		for (ancestor = per_process; ancestor != NULL; ancestor = ancestor->inherited) {
+			sys = READ_ONCE(ancestor->syscall_table[syscall]);
+			if (sys != NULL && sys->argument_count == argument_count) {
+				export_syscall_table(seccomp, syscall, sys);
+			}
+		}
+		cond_resched();
+	}
+
+out:
+	put_seccomp_draco(export_config);
+	export_config = NULL;
+	mutex_unlock(&export_mutex);
+	rcu_read_lock();
+	put_process_table(&hash_table, per_process);
+	rcu_read_unlock();
+	return ret;
+}
+
+static ssize_t export_write(struct file* file, const char __user* buffer, 
+	size_t count, loff_t* position) {
+
+	struct pid* pid;
+	struct task_struct* task;
+	int nr;
+	int ret;
+
+	ret = kstrtoint_from_user(buffer, count, 10, &nr);
+	if (ret) {
+		return ret;
+	}
+	pid = find_get_pid(nr);
+	task = get_pid_task(pid, PIDTYPE_PID);
+	put_pid(pid);
+	if (task == NULL) {
+		return -ESRCH;
+	}
+
+	ret = export_task(task);
+	put_task_struct(task);
+	return ret ? ret : count;
+}
+
+static ssize_t export_read(struct file* file, char __user* buffer, 
+	size_t count, loff_t* position) {
+
+	ssize_t ret;
+
+	mutex_lock(&export_mutex);
+	ret = simple_read_from_buffer(buffer, count, position, export_entries, 
+		export_count*sizeof(*export_entries));
+	mutex_unlock(&export_mutex);
+	return ret;
+}
+
+static const struct file_operations export_fops = {
+	.owner = THIS_MODULE,
+	.read = export_read,
+	.write = export_write,
+	.llseek = default_llseek,
+};
+
+#ifdef METRICS_DRACO
+/*
+ * The statistics files only ever read the per-CPU counters and walk the
+ * registry shards under rcu_read_lock(), so reading them takes no lock the
+ * syscall path takes. A reader starts again at each page of output.
+ */
+static hash_table_per_process_type* registry_first(int cpu) {
+	struct hlist_node* node;
+
+	for (; cpu < nr_cpu_ids; cpu = cpumask_next(cpu, cpu_possible_mask)) {
+		node = rcu_dereference(hlist_first_rcu(&per_cpu_ptr(hash_table.registry, cpu)->head));
+		if (node != NULL) {
+			return hlist_entry(node, hash_table_per_process_type, registry);
+		}
+	}
+	return NULL;
+}
+
+// A cache unlinked meanwhile still leads back into its shard, or past it.
+static hash_table_per_process_type* registry_next(hash_table_per_process_type* per_process) {
+	struct hlist_node* node;
+
+	node = rcu_dereference(hlist_next_rcu(&per_process->registry));
+	if (node != NULL) {
+		return hlist_entry(node, hash_table_per_process_type, registry);
+	}
+	return registry_first(cpumask_next(per_process->shard, cpu_possible_mask));
+}
+
+static void* registry_seq_start(struct seq_file* m, loff_t* position) {
+	hash_table_per_process_type* per_process;
+	loff_t skip = *position;
+
+	rcu_read_lock();
+	if (skip == 0) {
+		return SEQ_START_TOKEN;
+	}
+	per_process = registry_first(cpumask_first(cpu_possible_mask));
+	while (per_process != NULL && --skip > 0) {
+		per_process = registry_next(per_process);
+	}
+	return per_process;
+}
+
+static void* registry_seq_next(struct seq_file* m, void* v, loff_t* position) {
+	++*position;
+	if (v == SEQ_START_TOKEN) {
+		return registry_first(cpumask_first(cpu_possible_mask));
+	}
+	return registry_next(v);
+}
+
+static void registry_seq_stop(struct seq_file* m, void* v) {
+	rcu_read_unlock();
+}
+
+// Bytes of @t, under rcu_read_lock(); adds its ways to @ways.
+static unsigned long argument_table_bytes(argument_table_type* t, unsigned long* ways) {
+	if (t == NULL) {
+		return 0;
+	}
+	*ways += t->size*ASOS;
+	return argument_table_footprint(t->size, t->argument_count);
+}
+
+static unsigned long syscall_table_bytes(
+	hash_table_per_process_per_syscall_type* sys, unsigned long* ways) {
+
+	return sizeof(*sys) + argument_table_bytes(rcu_dereference(sys->active), ways) + 
+		argument_table_bytes(rcu_dereference(sys->old), ways);
+}
+
+static int processes_seq_show(struct seq_file* m, void* v) {
+	hash_table_per_process_type* per_process = v;
+	hash_table_per_process_per_syscall_type* sys;
+	unsigned long bytes = sizeof(*per_process);
+	unsigned long ways = 0;
+	unsigned long occupied = 0;
+	int syscall;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_puts(m, "pid node users calls misses conflicts tables ways occupied bytes\n");
+		return 0;
+	}
+	for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+		sys = READ_ONCE(per_process->syscall_table[syscall]);
+		if (sys != NULL) {
+			bytes += syscall_table_bytes(sys, &ways);
+			occupied += atomic_read(&sys->occupied);
+		}
+	}
+	seq_printf(m, "%d %d %d %llu %llu %llu %llu %lu %lu %lu\n",
+		per_process->process_id,
+		per_process->node,
+		atomic_read(&per_process->users),
+		METRICS_SUM(per_process->metrics, per_process_call_count),
+		METRICS_SUM(per_process->metrics, per_process_argument_count),
+		METRICS_SUM(per_process->metrics, per_process_conflict_count),
+		METRICS_SUM(per_process->metrics, per_process_syscall_count),
+		ways, occupied, bytes);
+	return 0;
+}
+
+static int syscalls_seq_show(struct seq_file* m, void* v) {
+	hash_table_per_process_type* per_process = v;
+	hash_table_per_process_per_syscall_type* sys;
+	unsigned long bytes;
+	unsigned long ways;
+	int syscall;
+
+	if (v == SEQ_START_TOKEN) {
+		seq_puts(m, "pid syscall arguments node calls misses conflicts bypassing ways occupied bytes\n");
+		return 0;
+	}
+	for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+		sys = READ_ONCE(per_process->syscall_table[syscall]);
+		if (sys == NULL) {
+			continue;
+		}
+		ways = 0;
+		bytes = syscall_table_bytes(sys, &ways);
+		seq_printf(m, "%d %d %d %d %llu %llu %llu %d %lu %d %lu\n",
+			per_process->process_id,
+			syscall,
+			sys->argument_count,
+			READ_ONCE(sys->node),
+			METRICS_SUM(sys->metrics, per_syscall_call_count),
+			METRICS_SUM(sys->metrics, per_syscall_argument_count),
+			METRICS_SUM(sys->metrics, per_syscall_conflict_count),
+			bypassing(sys),
+			ways, atomic_read(&sys->occupied), bytes);
+	}
+	return 0;
+}
+
+static const struct seq_operations processes_seq_ops = {
+	.start = registry_seq_start,
+	.next = registry_seq_next,
+	.stop = registry_seq_stop,
+	.show = processes_seq_show,
+};
+
+static const struct seq_operations syscalls_seq_ops = {
+	.start = registry_seq_start,
+	.next = registry_seq_next,
+	.stop = registry_seq_stop,
+	.show = syscalls_seq_show,
+};
+
+static int processes_open(struct inode* inode, struct file* file) {
+	return seq_open(file, &processes_seq_ops);
+}
+
+static int syscalls_open(struct inode* inode, struct file* file) {
+	return seq_open(file, &syscalls_seq_ops);
+}
+
+static const struct file_operations processes_fops = {
+	.owner = THIS_MODULE,
+	.open = processes_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = seq_release,
+};
+
+static const struct file_operations syscalls_fops = {
+	.owner = THIS_MODULE,
+	.open = syscalls_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = seq_release,
+};
+
+static int stats_show(struct seq_file* m, void* v) {
+	int node;
+
+	seq_printf(m, 
+		"hit_count %llu\n"
+		"call_count %llu\n"
+		"argument_count %llu\n"
+		"conflict_count %llu\n"
+		"syscall_count %llu\n"
+		"process_count %llu\n"
+		"bypass_count %llu\n"
+		"local_call_count %llu\n"
+		"remote_call_count %llu\n"
+		"rehome_count %llu\n",
+		METRICS_SUM(hash_table.metrics, total_hit_count), 
+		METRICS_SUM(hash_table.metrics, total_call_count),
+		METRICS_SUM(hash_table.metrics, total_argument_count),
+		METRICS_SUM(hash_table.metrics, total_conflict_count),
+		METRICS_SUM(hash_table.metrics, total_syscall_count),
+		METRICS_SUM(hash_table.metrics, total_process_count),
+		METRICS_SUM(hash_table.metrics, total_bypass_count),
+		METRICS_SUM(hash_table.metrics, total_local_call_count),
+		METRICS_SUM(hash_table.metrics, total_remote_call_count),
+		METRICS_SUM(hash_table.metrics, total_rehome_count)
+	);
+	// Lookups made from the CPUs of each node, and rehomes to it.
+	for_each_online_node(node) {
+		seq_printf(m, 
+			"node%d_local_call_count %llu\n"
+			"node%d_remote_call_count %llu\n"
+			"node%d_rehome_count %llu\n",
+			node, METRICS_NODE_SUM(hash_table.metrics, total_local_call_count, node),
+			node, METRICS_NODE_SUM(hash_table.metrics, total_remote_call_count, node),
+			node, METRICS_NODE_SUM(hash_table.metrics, total_rehome_count, node)
+		);
+	}
+	return 0;
+}
+
+/*
+ * Zero every counter, the global ones and those of every cache. A counter
+ * bumped on another CPU while it is zeroed may lose that increment.
+ */
+void reset_metrics(hash_table_type* hash_table) {
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_per_syscall_type* sys;
+	draco_cgroup_type* cgroup;
+	int syscall;
+	int bucket;
+
+	METRICS_RESET(hash_table->metrics);
+	bitmap_zero(syscall_seen, SYSCALL_COUNT);
+
+	rcu_read_lock();
+	hash_for_each_rcu(draco_cgroups, bucket, cgroup, node) {
+		METRICS_RESET(cgroup->metrics);
+	}
+	for (per_process = registry_first(cpumask_first(cpu_possible_mask)); per_process != NULL; 
+		per_process = registry_next(per_process)) {
+
+		METRICS_RESET(per_process->metrics);
+		for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+			sys = READ_ONCE(per_process->syscall_table[syscall]);
+			if (sys != NULL) {
+				METRICS_RESET(sys->metrics);
+			}
+		}
+	}
+	rcu_read_unlock();
+}
+
+static ssize_t stats_write(struct file* file, const char __user* buffer, 
+	size_t count, loff_t* position) {
+
+	reset_metrics(&hash_table);
+	return count;
+}
+
+static int stats_open(struct inode* inode, struct file* file) {
+	return single_open(file, stats_show, NULL);
+}
+
+static const struct file_operations stats_fops = {
+	.owner = THIS_MODULE,
+	.open = stats_open,
+	.read = seq_read,
+	.write = stats_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+#endif
+
+// The path comes last, it may contain blanks.
+static int cgroups_show(struct seq_file* m, void* v) {
+	draco_cgroup_type* cgroup;
+	char* path;
+	int bucket;
+
+	path = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (path == NULL) {
+		return -ENOMEM;
+	}
+
+	#ifdef METRICS_DRACO
+		seq_puts(m, "caches bytes calls hits misses conflicts denied cgroup\n");
+	#else
+		seq_puts(m, "caches bytes cgroup\n");
+	#endif
+	rcu_read_lock();
+	hash_for_each_rcu(draco_cgroups, bucket, cgroup, node) {
+		if (cgroup->css == NULL) {
+			strcpy(path, "/");
+		} else if (cgroup_path(cgroup->css->cgroup, path, PATH_MAX) < 0) {
+			strcpy(path, "?");
+		}
+		seq_printf(m, "%d %ld", atomic_read(&cgroup->users), atomic_long_read(&cgroup->bytes));
+		#ifdef METRICS_DRACO
+			seq_printf(m, " %llu %llu %llu %llu %llu",
+				METRICS_SUM(cgroup->metrics, per_cgroup_call_count),
+				METRICS_SUM(cgroup->metrics, per_cgroup_hit_count),
+				METRICS_SUM(cgroup->metrics, per_cgroup_argument_count),
+				METRICS_SUM(cgroup->metrics, per_cgroup_conflict_count),
+				METRICS_SUM(cgroup->metrics, per_cgroup_denied_count));
+		#endif
+		seq_printf(m, " %s\n", path);
+	}
+	rcu_read_unlock();
+
+	kfree(path);
+	return 0;
+}
+
+static int cgroups_open(struct inode* inode, struct file* file) {
+	return single_open(file, cgroups_show, NULL);
+}
+
+static const struct file_operations cgroups_fops = {
+	.owner = THIS_MODULE,
+	.open = cgroups_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+static struct dentry* draco_debugfs;
+
+void init_debugfs(void) {
+	draco_debugfs = debugfs_create_dir("draco", NULL);
+	if (IS_ERR_OR_NULL(draco_debugfs)) {
+		#ifdef ALERT_DRACO
+			printk (KERN_WARNING "[Draco:init_debugfs()]:debugfs_create_dir failed....");
+		#endif
+		draco_debugfs = NULL;
+		return;
+	}
+	debugfs_create_file("export", 0600, draco_debugfs, NULL, &export_fops);
+	debugfs_create_file("cgroups", 0400, draco_debugfs, NULL, &cgroups_fops);
+	#ifdef METRICS_DRACO
+		debugfs_create_file("stats", 0600, draco_debugfs, NULL, &stats_fops);
+		debugfs_create_file("processes", 0400, draco_debugfs, NULL, &processes_fops);
+		debugfs_create_file("syscalls", 0400, draco_debugfs, NULL, &syscalls_fops);
+	#endif
+	#ifdef LATENCY_DRACO
+		debugfs_create_file("latency", 0600, draco_debugfs, NULL, &latency_fops);
+	#endif
+}
+
+void free_debugfs(void) {
+	debugfs_remove_recursive(draco_debugfs);
+	draco_debugfs = NULL;
+	vfree(export_entries);
+	export_entries = NULL;
+	export_count = 0;
+}
+
+static int __seccomp_filter_handler(int this_syscall, struct pt_regs *regs, u32 *verdict) {
+
+	key_type key;
+	#ifdef LATENCY_DRACO
+		cycles_t start;
+		int found;
+	#endif
+	if (this_syscall < 0 || this_syscall >= SYSCALL_COUNT) {
+
+		#ifdef ALERT_DRACO
+			printk("Draco:__seccomp_filter_handler():"
+				"weirld syscall=%d\n"
+				"di=%lu\n"
+				"si=%lu\n"
+				"dx=%lu\n"
+				"r10=%lu\n"
+				"r8=%lu\n"
+				"r9=%lu\n",
+					this_syscall,
+					regs->di,
+					regs->si,
+					regs->dx,
+					regs->r10,
+					regs->r8,
+					regs->r9
+			);
+		#endif
+
+		return 0;
+	}
+
+
+	#ifdef METRICS_DRACO 
+		// Only the first sighting of a syscall writes the shared bitmap.
+		if (!test_bit(this_syscall, syscall_seen) &&
+			!test_and_set_bit(this_syscall, syscall_seen)) {
+			this_cpu_inc(hash_table.metrics->total_syscall_count);
+		}
+	#endif
+		
+	init_key(&key, this_syscall, regs);
+	#ifdef LATENCY_DRACO
+		start = get_cycles();
+		found = lookup_value(&hash_table, &key, verdict);
+		record_latency(this_syscall, found ? LATENCY_HIT : LATENCY_MISS, start);
+		if (!found) {
+			start_filter_latency(this_syscall);
+		}
+		return found;
+	#else
+		return lookup_value(&hash_table, &key, verdict);
+	#endif
+}
+
+static void __seccomp_record_handler(int this_syscall, struct pt_regs *regs, u32 verdict) {
+
+	key_type key;
+	#ifdef LATENCY_DRACO
+		cycles_t start;
+	#endif
+	if (this_syscall < 0 || this_syscall >= SYSCALL_COUNT) {
+		return;
+	}
+
+	#ifdef LATENCY_DRACO
+		finish_filter_latency(this_syscall);
+		start = get_cycles();
+	#endif
+
+	init_key(&key, this_syscall, regs);
+	insert_value(&hash_table, &key, verdict);
+
+	#ifdef LATENCY_DRACO
+		record_latency(this_syscall, LATENCY_INSERT, start);
+	#endif
+}
+
+static void __seccomp_release_handler(struct task_struct *tsk) {
+	release_process_table(&hash_table, tsk);
+}
+
+static void __seccomp_fork_handler(struct task_struct *child) {
+	share_process_table(child);
+}
+
+static int __init draco_init(void) {
+	
+	int ret;
+
+	ret = init_hash_table(&hash_table);
+	if (ret) {
+		return ret;
+	}
+
+	#ifdef LATENCY_DRACO
+		ret = init_latency();
+		if (ret) {
+			free_hash_table(&hash_table);
+			return ret;
+		}
+	#endif
+
+	draco_checker = __seccomp_filter_handler;
+	draco_record = __seccomp_record_handler;
+	draco_release = __seccomp_release_handler;
+	draco_fork = __seccomp_fork_handler;
+
+	init_debugfs();
+	return 0;
+}
+
+static void __exit draco_exit(void) {
+	draco_checker = draco_checker_backup;
+	draco_record = draco_record_backup;
+	draco_release = draco_release_backup;
+	draco_fork = draco_fork_backup;
+	free_debugfs();
+	free_hash_table(&hash_table);
+	#ifdef LATENCY_DRACO
+		free_latency();
+	#endif
 }
 
 module_init(draco_init)
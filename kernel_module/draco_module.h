@@ -9,21 +9,236 @@
 #include <linux/jhash.h>
 #include <linux/seccomp.h>
 #include <linux/spinlock.h>
+#include <linux/percpu.h>
+#include <linux/topology.h>
+#include <linux/nodemask.h>
+#include <linux/bitmap.h>
+#include <linux/workqueue.h>
+#include <linux/rcupdate.h>
+#include <linux/rculist.h>
+#include <linux/seqlock.h>
+#include <linux/version.h>
+#include <linux/audit.h>
+#include <linux/cgroup.h>
+#include <linux/debugfs.h>
+#include <linux/fs.h>
+#include <linux/hashtable.h>
+#include <linux/mutex.h>
+#include <linux/pid.h>
+#include <linux/seq_file.h>
+#include <linux/timex.h>
+#include <linux/uaccess.h>
+#include <linux/vmalloc.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 11, 0)
+#include <linux/sched/mm.h>
+#include <linux/sched/signal.h>
+#include <linux/sched/task.h>
+#endif
 
-#define INIT_HASH_ARGUMENT 149
+/*
+ * Defaults of the "initial_sets", "max_sets" and "hash_seed" module
+ * parameters. The first two only apply to tables created after they are
+ * changed, and argument tables never get more than HASH_ARGUMENT_LIMIT
+ * sets whatever "max_sets" says. Neither takes less than
+ * MIN_HASH_ARGUMENT: the cuckoo backend needs a second set to kick to.
+ */
+#define MIN_HASH_ARGUMENT 2
+#define INIT_HASH_ARGUMENT 37
+#define MAX_HASH_ARGUMENT 2341
+#define HASH_ARGUMENT_LIMIT 597869
 #define JHASH_INIT 10000004
 
+/*
+ * A syscall keyed on a single argument keeps the canonical values below
+ * DIRECT_VALUES that the filter allowed as bits of a bitmap indexed by the
+ * value (DIRECT_VALUES/8 bytes) instead of rows of its hash table.
+ */
+#define DIRECT_VALUES 1024
+
+/*
+ * Writing a pid to <debugfs>/draco/export snapshots what the cache of its
+ * thread group learned, at most EXPORT_MAX_ENTRIES tuples, and reading the
+ * file returns them as an array of struct seccomp_data: the input of
+ * PR_DRACO_PREWARM_SECCOMP. A new instance of the same image with the same
+ * filter loads it with seccomp_draco_import(), its filter checking every
+ * tuple again.
+ */
+#define EXPORT_MAX_ENTRIES 65536
+
+/*
+ * With METRICS_DRACO, <debugfs>/draco/stats holds the global counters and
+ * writing anything to it zeroes every counter; processes and syscalls hold
+ * a line per cache and per syscall table of a cache: its counters, how
+ * many ways its argument tables have and hold, and the bytes they take.
+ */
+
+/*
+ * A per-syscall table grows once it is GROW_LOAD_PERCENT full, or once
+ * GROW_CONFLICT_PERCENT of the tuples that missed since the last resize
+ * were dropped because their set was full (judged after GROW_MIN_SAMPLES).
+ * The bigger table is allocated from a workqueue and the old sets are then
+ * moved over MIGRATE_STEP at a time by whichever thread gets sys->lock.
+ */
+#define GROW_LOAD_PERCENT 75
+#define GROW_CONFLICT_PERCENT 10
+#define GROW_MIN_SAMPLES 16
+// A size that could not be allocated or charged is not tried again before.
+#define GROW_RETRY_PERIOD (10*HZ)
+#define MIGRATE_STEP 8
+
+/*
+ * Tables are allocated on the NUMA node of the CPU the task runs on. With
+ * the "numa_rehome" module parameter set, lookups of a syscall are
+ * counted as local or remote to the node of its argument table, per CPU
+ * in windows of REHOME_WINDOW, then per syscall. Once REHOME_SAMPLES are
+ * counted, if remote lookups outnumbered local ones REHOME_RATIO to one,
+ * the argument table is reallocated on the node of a remote CPU, at the
+ * same size, and migrated like a grown one; at most once per
+ * REHOME_PERIOD jiffies. The per-syscall header stays where it is.
+ * Moving back takes the same majority the other way, so a group spread
+ * evenly over several nodes does not bounce it around.
+ * grow_pending has GROW_PENDING set while a new table is on its way, and
+ * REHOME_PENDING as well if it is a rehome rather than a resize.
+ */
+#define REHOME_WINDOW 64
+#define REHOME_SAMPLES 256
+#define REHOME_RATIO 3
+#define REHOME_PERIOD HZ
+#define GROW_PENDING 0
+#define REHOME_PENDING 1
+
+/*
+ * Backends of the per-syscall argument table, picked with the "backend"
+ * module parameter when a table is created. The cuckoo backend gives
+ * every tuple two candidate sets, displaces residents along a chain of at
+ * most CUCKOO_MAX_KICKS moves and parks the leftovers in a small stash,
+ * which lets a table fill up much further before growing.
+ */
+#define BACKEND_SET_ASSOCIATIVE 0
+#define BACKEND_CUCKOO 1
+
+#define CUCKOO_MAX_KICKS 16
+#define CUCKOO_STASH_SIZE 4
+#define CUCKOO_GROW_LOAD_PERCENT 95
+#define CUCKOO_SEED 0x9e3779b9
+
+/*
+ * Hash of an argument tuple, picked with the "hash_function" module
+ * parameter. HASH_JHASH runs jhash() over the bytes and reduces it modulo
+ * a prime table size. HASH_WORDS mixes the words with one multiply and
+ * xorshift each and masks it with a power-of-two table size.
+ */
+#define HASH_JHASH 0
+#define HASH_WORDS 1
+
+#define WORD_HASH_MULTIPLIER 0x9e3779b97f4a7c15ULL
+
+/*
+ * What the set-associative backend does with a new tuple whose set is
+ * full, picked with the "replacement" module parameter: drop it, or
+ * overwrite a resident chosen by CLOCK (a way hit since the hand last
+ * passed it gets a second chance) or at random.
+ */
+#define REPLACE_NONE 0
+#define REPLACE_CLOCK 1
+#define REPLACE_RANDOM 2
+
+/*
+ * REPLACE_CLOCK keeps a byte of bits per set: a referenced bit per way,
+ * then the two bits of the set's own hand. Probes set the referenced bits
+ * without the lock, so the hand bits are changed with atomic bitops too.
+ */
+#define CLOCK_SET_BITS 8
+#define CLOCK_HAND_BIT 4
+
+/*
+ * A syscall whose arguments hardly ever repeat (buffers, stack addresses)
+ * only pays for hashing and inserting. Every CPU looks at the hit rate of
+ * its last BYPASS_WINDOW calls of a syscall; below "bypass_hit_percent"
+ * the syscall goes straight to the filter for BYPASS_PERIOD jiffies, twice
+ * as long each time the next window is still bad, up to BYPASS_MAX_SHIFT
+ * doublings.
+ */
+#define BYPASS_WINDOW 256
+#define BYPASS_PERIOD (HZ/10 + 1)
+#define BYPASS_MAX_SHIFT 6
+
+/*
+ * Every set has one 64-bit tag word, a 16-bit tag per way: TAG_EMPTY,
+ * TAG_BUSY, or a fingerprint of the tuple's hash (>= TAG_FIRST). A probe
+ * compares the fingerprint against all ways of the word at once and only
+ * reads the argument rows whose tag matched, so a miss touches a single
+ * word. A way is claimed with cmpxchg() from TAG_EMPTY to TAG_BUSY,
+ * filled, and published with its fingerprint; ways never go back to
+ * TAG_EMPTY, so the used ways of a set are always a prefix of it.
+ */
+#define TAG_EMPTY 0
+#define TAG_BUSY 1
+#define TAG_FIRST 2
+#define TAG_LANES 0x0001000100010001ULL
+#define TAG_LOW_BITS 0x7fff7fff7fff7fffULL
+
 #define ALERT_DRACO
 //#define DEBUG_DRACO
 #define METRICS_DRACO
+//#define LATENCY_DRACO
 
 #define ASOS 4
-#define PRE_ALLOCATED_SYSCALL_TABLE_COUNT 10000
 
+#ifdef LATENCY_DRACO
+/*
+ * With LATENCY_DRACO every CPU counts, per syscall, how many cycles
+ * (get_cycles(), the TSC on x86) each lookup that hit, each lookup that
+ * missed, each filter run after a miss and each insert took, in log2
+ * buckets: bucket b holds the durations d with fls64(d) == b, the last one
+ * everything longer. <debugfs>/draco/latency sums them over CPUs, and
+ * writing anything to it zeroes them.
+ */
+#define LATENCY_BUCKETS 32
+
+enum latency_kind {
+	LATENCY_HIT,
+	LATENCY_MISS,
+	LATENCY_FILTER,
+	LATENCY_INSERT,
+	LATENCY_KINDS
+};
+
+typedef struct latency_histogram {
+	u32 count[SYSCALL_COUNT][LATENCY_KINDS][LATENCY_BUCKETS];
+} latency_histogram_type;
+
+/*
+ * When the lookup of a syscall missed on a CPU, to time the filter run
+ * that follows. A task migrated meanwhile finds another task's stamp, or
+ * none, and its filter run is not counted.
+ */
+typedef struct latency_stamp {
+	struct task_struct* task;
+	int syscall;
+	cycles_t start;
+} latency_stamp_type;
+#endif
+
+// A row is the tuple followed by the filter's verdict for it.
+#define ROW_WORDS(argument_count) ((argument_count) + 1)
+
+// Charged to the memory cgroup of the allocating task where the kernel can,
+// grow_work switches to the one its table is attributed to.
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4, 5, 0)
+#define KMALLOC_FLAG (GFP_KERNEL | __GFP_ACCOUNT)
+#else
 #define KMALLOC_FLAG GFP_KERNEL
+#endif
 
-extern int (*draco_checker)(int, struct pt_regs*);
-extern int (*draco_checker_backup)(int, struct pt_regs*);
+extern int (*draco_checker)(int, struct pt_regs*, u32*);
+extern int (*draco_checker_backup)(int, struct pt_regs*, u32*);
+extern void (*draco_record)(int, struct pt_regs*, u32);
+extern void (*draco_record_backup)(int, struct pt_regs*, u32);
+extern void (*draco_release)(struct task_struct*);
+extern void (*draco_release_backup)(struct task_struct*);
+extern void (*draco_fork)(struct task_struct*);
+extern void (*draco_fork_backup)(struct task_struct*);
 
 typedef struct k {
 	int syscall_id;
@@ -31,55 +246,255 @@ typedef struct k {
 	#ifdef METRICS_DRACO
 		pid_t process_id;
 	#endif
-	unsigned long argument_list[MAX_ARGUMENT_COUNT];
+	unsigned long argument_list[ROW_WORDS(MAX_ARGUMENT_COUNT)];
 } key_type;
 
+#ifdef METRICS_DRACO
+/*
+ * The counters are kept per-CPU and only summed up when somebody reads
+ * them, so bumping a counter in insert_value() never bounces a shared
+ * cache line.
+ */
+typedef struct per_syscall_metrics {
+	unsigned long per_syscall_conflict_count;
+	unsigned long per_syscall_argument_count;
+	unsigned long per_syscall_call_count;
+} per_syscall_metrics_type;
+
+typedef struct per_process_metrics {
+	unsigned long per_process_argument_count;
+	unsigned long per_process_syscall_count;
+	unsigned long per_process_call_count;
+	unsigned long per_process_conflict_count;
+} per_process_metrics_type;
+
+typedef struct per_cgroup_metrics {
+	unsigned long per_cgroup_call_count;
+	unsigned long per_cgroup_hit_count;
+	unsigned long per_cgroup_argument_count;
+	unsigned long per_cgroup_conflict_count;
+	unsigned long per_cgroup_denied_count; // Allocations over cgroup_cache_kb.
+} per_cgroup_metrics_type;
+
+typedef struct total_metrics {
+	unsigned long total_process_count;
+	unsigned long total_call_count;
+	unsigned long total_conflict_count;
+	unsigned long total_hit_count;
+	unsigned long total_argument_count;
+	unsigned long total_syscall_count;
+	unsigned long total_bypass_count;
+	unsigned long total_local_call_count; // Argument table on this CPU's node.
+	unsigned long total_remote_call_count;
+	unsigned long total_rehome_count;
+} total_metrics_type;
+
+#define METRICS_SUM(metrics, field) ({				\
+	u64 __sum = 0;							\
+	int __cpu;							\
+	for_each_possible_cpu(__cpu)					\
+		__sum += per_cpu_ptr((metrics), __cpu)->field;		\
+	__sum;								\
+})
+
+#define METRICS_RESET(metrics) do {					\
+	int __cpu;							\
+	for_each_possible_cpu(__cpu)					\
+		memset(per_cpu_ptr((metrics), __cpu), 0,		\
+			sizeof(*per_cpu_ptr((metrics), __cpu)));	\
+} while (0)
+
+// What the CPUs of @node counted.
+#define METRICS_NODE_SUM(metrics, field, node) ({			\
+	u64 __sum = 0;							\
+	int __cpu;							\
+	for_each_possible_cpu(__cpu)					\
+		if (cpu_to_node(__cpu) == (node))			\
+			__sum += per_cpu_ptr((metrics), __cpu)->field;	\
+	__sum;								\
+})
+#endif
+
+/*
+ * A cache is attributed to the memory cgroup of the thread that created
+ * it, for as long as it lives. Every such cgroup has a draco_cgroup,
+ * holding a reference to it, that adds up the bytes its caches and their
+ * tables take and, with METRICS_DRACO, their counters; it goes with the
+ * last of its caches. <debugfs>/draco/cgroups has a line per cgroup.
+ * Without memory cgroups every cache is attributed to a single one.
+ *
+ * With "cgroup_cache_kb" set, a cgroup whose caches take that much gets
+ * no new cache nor table until some are freed: its syscalls go to the
+ * filter uncached rather than evict what other containers learned. Once
+ * denied a cache, its tasks do not ask for one again before
+ * CGROUP_DENY_PERIOD jiffies.
+ */
+#define DRACO_CGROUP_BITS 6
+#define CGROUP_DENY_PERIOD HZ
+
+typedef struct draco_cgroup {
+	struct hlist_node node; // On draco_cgroups, looked up under RCU.
+	struct cgroup_subsys_state* css; // NULL without memory cgroups.
+	atomic_t users; // Caches attributed to it.
+	atomic_long_t bytes;
+	unsigned long denied_until; // In jiffies, no new cache before; 0 if never denied.
+	struct rcu_head rcu;
+
+	#ifdef METRICS_DRACO
+		per_cgroup_metrics_type __percpu* metrics;
+	#endif
+} draco_cgroup_type;
+
+/*
+ * A row holds exactly argument_count words and the verdict the filter
+ * gave them, and the ASOS rows of a set form a bucket of bucket_words
+ * words: a power of two up to a cache line, whole cache lines beyond, so
+ * that no bucket straddles more lines than it has to. The bucket array
+ * starts on a cache line.
+ */
+typedef struct argument_table {
+	u32 size; // number of sets, each set has ASOS ways
+	u32 mask; // size - 1 for power-of-two sizes, 0 otherwise
+	uint8_t set_bits; // log2(size) for power-of-two sizes, 0 otherwise
+	unsigned long* table;
+	void* table_memory; // What table was carved from, for kfree().
+	u64* tags; // One tag word per set.
+	unsigned long* referenced; // CLOCK_SET_BITS per set for REPLACE_CLOCK, else NULL.
+	uint8_t argument_count;
+	u16 bucket_words;
+	int node; // Where its rows and tags were allocated.
+	draco_cgroup_type* cgroup; // Charged for it, NULL once retired.
+
+	uint8_t cuckoo;
+	uint8_t kick_way; // Under sys->lock.
+	uint8_t stash_count; // Written under sys->lock, read lock-free.
+	unsigned long stash[CUCKOO_STASH_SIZE][ROW_WORDS(MAX_ARGUMENT_COUNT)];
+	u16 stash_tag[CUCKOO_STASH_SIZE];
+	struct rcu_head rcu;
+} argument_table_type;
+
+typedef struct sample_window {
+	unsigned int calls;
+	unsigned int hits;
+	unsigned int local; // Lookups from this node, with "numa_rehome" set.
+	unsigned int remote;
+} sample_window_type;
+
+/*
+ * Shared by every thread of the group. Lookups run under rcu_read_lock()
+ * without taking any lock, and tuples are added to free ways lock-free.
+ * @active stays NULL until the first tuple that @direct_allowed cannot
+ * hold, and is then allocated with @initial_size sets.
+ * Only overwriting a valid row (cuckoo displacement) and resizing take
+ * sys->lock; the former is wrapped in sys->seq so that a reader which
+ * compared against a half-written row discards its hit.
+ */
 typedef struct hash_table_per_process_per_syscall {
-	unsigned long table[ASOS*INIT_HASH_ARGUMENT][MAX_ARGUMENT_COUNT];
-	uint8_t flag[ASOS*INIT_HASH_ARGUMENT];
+	uint8_t argument_count; // Row width of all its tables.
+	u32 initial_size; // Sets of the first table.
+	int node; // Where its argument tables are allocated.
+	draco_cgroup_type* cgroup; // Its tables are charged to it.
+	unsigned long rehome_after; // In jiffies, no rehome before.
+	atomic_t rehome_local; // Full windows of lookups since the last decision.
+	atomic_t rehome_remote;
+	argument_table_type __rcu* active; // New tuples always go here.
+	argument_table_type __rcu* old; // Being drained into active, NULL when idle.
+	u32 migrate_cursor; // Sets of old below the cursor are already moved.
+
+	atomic_t occupied;
+	atomic_t inserted_since_resize;
+	atomic_t conflict_since_resize;
+
+	spinlock_t lock;
+	seqcount_t seq;
+
+	argument_table_type* grown; // Published by grow_work, swapped in under lock.
+	unsigned long grow_pending;
+	struct work_struct grow_work;
+	u32 grow_failed_size; // Sets of the last grow that failed, 0 if none.
+	unsigned long grow_retry_after; // In jiffies, when grow_failed_size may be tried again.
+
+	sample_window_type __percpu* window;
+	unsigned long bypass_until; // In jiffies, caching resumes once jiffies passes it; 0 if never bypassed.
+	uint8_t bypass_shift;
+
+	DECLARE_BITMAP(direct_allowed, DIRECT_VALUES); // Only set bits, never cleared.
 
 	#ifdef METRICS_DRACO
-		uint32_t per_syscall_conflict_count;
-		uint32_t per_syscall_argument_count;
-		uint32_t per_syscall_call_count;
+		per_syscall_metrics_type __percpu* metrics;
 	#endif
 
 } hash_table_per_process_per_syscall_type;
 
+#define DRACO_GROUP_BITS 8
 
-typedef struct per_syscall_call_pool {
-	hash_table_per_process_per_syscall_type pool_internal[PRE_ALLOCATED_SYSCALL_TABLE_COUNT];
-	int cursor;
-} per_syscall_call_pool_type;
-
+/*
+ * One per thread group: threads cloned with CLONE_THREAD take a reference
+ * in draco_fork and the last one to exit frees it. The tuples in it were
+ * only checked against @filter and keyed as the Draco configuration of
+ * @generation says, so a thread whose filter or configuration differs (it
+ * installed another one since) drops its reference and starts a new
+ * cache. @filter cannot be freed and reused while the cache is alive: it
+ * is part of the filter chain of every thread holding a reference.
+ *
+ * Every cache is also published in draco_groups under the signal_struct
+ * of its group, until its last reference goes: a thread whose cache went
+ * stale, e.g. after a TSYNC filter, or that failed to build one, adopts
+ * the cache another thread of the group built for its filter and
+ * configuration rather than building a private one.
+ *
+ * A forked child with the same filter starts with a reference to its
+ * parent's cache in @inherited and reads the parent's table of a syscall
+ * until its first miss on it. Its own table then starts at "initial_sets",
+ * with the tables up the chain behind it: a tuple found there is copied
+ * over.
+ *
+ * Syscalls configured without arguments have no table at all, only a bit
+ * in @argument_free_syscalls and their verdict in @argument_free_verdicts.
+ */
 typedef struct hash_table_per_process {
 	hash_table_per_process_per_syscall_type* syscall_table[SYSCALL_COUNT];
+	struct hlist_node registry; // On its shard, unhashed once it left it.
+	struct hlist_node group_node; // In draco_groups, unhashed once it left it.
+	struct signal_struct* group; // Of the thread group that built it.
+	int shard; // The CPU whose registry shard it is on.
+	int node; // Where it was allocated.
+	draco_cgroup_type* cgroup; // Holds a reference to it.
+	struct list_head list; // On the dead list of free_hash_table().
+	struct rcu_head rcu;
+	struct work_struct free_work;
+	struct seccomp_filter* filter;
+	int generation; // current->seccomp.draco_generation when created.
+	atomic_t users;
+	struct hash_table_per_process* inherited;
+	DECLARE_BITMAP(argument_free_syscalls, SYSCALL_COUNT);
+	u32 argument_free_verdicts[SYSCALL_COUNT];
 		
 	#ifdef METRICS_DRACO
-		uint32_t per_process_argument_count;
-		uint32_t per_process_syscall_count;
-		uint32_t per_process_call_count;
-		uint32_t per_process_conflict_count;
+		per_process_metrics_type __percpu* metrics;
 		pid_t process_id;
 	#endif
 } hash_table_per_process_type;
 
-typedef struct process_node {
-	struct process_node* next;
-	struct task_struct* process;
-} process_node_type;
+/*
+ * Every cache is registered on the shard of the CPU that created it, so
+ * that tasks starting on different CPUs never contend for a lock. Shards
+ * are walked under rcu_read_lock(): a cache leaves its shard when its last
+ * reference is dropped and is freed a grace period later.
+ */
+typedef struct registry_shard {
+	spinlock_t lock;
+	struct hlist_head head;
+} registry_shard_type;
 
 typedef struct hash_table {
-	process_node_type process_head; 
-	per_syscall_call_pool_type pool;
+	registry_shard_type __percpu* registry;
+	struct kmem_cache* syscall_table_cache;
+	struct kmem_cache* process_table_cache;
+	struct workqueue_struct* workqueue; // grow_work and free_work, drained at unload.
 
 	#ifdef METRICS_DRACO
-		uint32_t total_process_count;
-		uint32_t total_call_count;
-		uint32_t total_conflict_count;
-		uint32_t total_hit_count;
-		uint32_t total_argument_count;
-		uint32_t total_syscall_count;
+		total_metrics_type __percpu* metrics;
 	#endif
 
 } hash_table_type;
@@ -89,14 +504,121 @@ hash_table_type hash_table;
 
 int init_hash_table(hash_table_type* hash_table_internal);
 inline unsigned long get_argument(struct pt_regs* regs, uint8_t index);
+inline unsigned long canonical_argument(
+	struct seccomp_draco_config* config, int syscall, uint8_t position, unsigned long value);
 inline void arguments_hash_function(key_type* key); 
 inline void init_key(key_type* k, int syscall_id, struct pt_regs* regs);
-inline hash_table_per_process_per_syscall_type* get_item_from_pool(hash_table_type* hash_table);
-int insert_value(hash_table_type* hash_table, key_type* key);
+inline hash_table_per_process_per_syscall_type* alloc_syscall_table(hash_table_type* hash_table, 
+	u32 size, int argument_count, int node, draco_cgroup_type* cgroup);
+void free_syscall_table(hash_table_type* hash_table, hash_table_per_process_per_syscall_type* item);
+void free_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process);
+void release_process_table(hash_table_type* hash_table, struct task_struct* tsk);
+draco_cgroup_type* get_cgroup(void);
+int cgroup_denied(void);
+void put_cgroup(draco_cgroup_type* cgroup);
+int charge_cgroup(draco_cgroup_type* cgroup, unsigned long bytes);
+void uncharge_cgroup(draco_cgroup_type* cgroup, unsigned long bytes);
+void register_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process);
+int unregister_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process);
+void publish_process_table(hash_table_per_process_type* per_process);
+void unpublish_process_table(hash_table_per_process_type* per_process);
+hash_table_per_process_type* group_process_table(void);
+void put_process_table(hash_table_type* hash_table, hash_table_per_process_type* per_process);
+void free_process_table_work(struct work_struct* work);
+void free_dead_process_tables(hash_table_type* hash_table, struct list_head* dead);
+void share_process_table(struct task_struct* child);
+int lookup_inherited(hash_table_per_process_type* per_process, key_type* key, 
+	int argument_count, u32* verdict);
+argument_table_type* alloc_argument_table(u32 size, int argument_count, gfp_t flags, int node);
+unsigned long argument_table_footprint(u32 size, int argument_count);
+void release_argument_table(argument_table_type* t);
+int install_argument_table(hash_table_per_process_per_syscall_type* sys);
+inline unsigned long* probe_set(argument_table_type* t, u32 set, u16 tag, 
+	unsigned long* argument_list, int argument_count);
+inline unsigned long* probe_table(argument_table_type* t, u32 hash_code, 
+	unsigned long* argument_list, int argument_count, u32 from_set);
+inline int lookup_argument(hash_table_per_process_per_syscall_type* sys, u32 hash_code, 
+	unsigned long* argument_list, int argument_count, u32* verdict);
+inline int place_argument(argument_table_type* t, u32 hash_code, 
+	unsigned long* argument_list, int argument_count);
+int cuckoo_kick(hash_table_per_process_per_syscall_type* sys, argument_table_type* t, 
+	u32 hash_code, unsigned long* argument_list, int argument_count);
+int replace_argument(hash_table_per_process_per_syscall_type* sys, argument_table_type* t, 
+	u32 hash_code, unsigned long* argument_list, int argument_count);
+inline u32 hash_arguments(unsigned long* argument_list, int argument_count);
+void grow_work_handler(struct work_struct* work);
+void maybe_grow(hash_table_per_process_per_syscall_type* sys);
+void maybe_rehome(hash_table_type* hash_table, hash_table_per_process_per_syscall_type* sys);
+void migrate_step(hash_table_per_process_per_syscall_type* sys, int argument_count);
+int bypassing(hash_table_per_process_per_syscall_type* sys);
+void sample_hit_rate(hash_table_per_process_per_syscall_type* sys, int hit);
+void sample_node(hash_table_type* hash_table, hash_table_per_process_per_syscall_type* sys, int remote);
+int lookup_argument_free(hash_table_per_process_type* per_process, int syscall, u32* verdict);
+void record_argument_free(hash_table_per_process_type* per_process, int syscall, u32 verdict);
+hash_table_per_process_type* current_process_table(hash_table_type* hash_table);
+int fill_arguments(key_type* key);
+int lookup_syscall(hash_table_per_process_per_syscall_type* sys, key_type* key, 
+	int argument_count, u32* verdict);
+int lookup_value(hash_table_type* hash_table, key_type* key, u32* verdict);
+void insert_value(hash_table_type* hash_table, key_type* key, u32 verdict);
 void free_hash_table(hash_table_type* hash_table);
+unsigned long representative_argument(
+	struct seccomp_draco_config* config, int syscall, uint8_t position, unsigned long canonical);
+int export_task(struct task_struct* task);
+#ifdef METRICS_DRACO
+void reset_metrics(hash_table_type* hash_table);
+#endif
+#ifdef LATENCY_DRACO
+int init_latency(void);
+void free_latency(void);
+void record_latency(int syscall, enum latency_kind kind, cycles_t start);
+#endif
+void init_debugfs(void);
+void free_debugfs(void);
+
+static int backend = BACKEND_SET_ASSOCIATIVE;
+module_param(backend, int, 0444);
+MODULE_PARM_DESC(backend, "Argument table backend: 0 = set-associative, 1 = cuckoo");
+
+static int hash_function = HASH_JHASH;
+module_param(hash_function, int, 0444);
+MODULE_PARM_DESC(hash_function, "Argument hash: 0 = jhash modulo a prime, 1 = word hash masked by a power of two");
+
+static int bypass_hit_percent = 10;
+module_param(bypass_hit_percent, int, 0644);
+MODULE_PARM_DESC(bypass_hit_percent, "Stop caching a syscall while fewer of its calls hit, in percent, 0 = never");
+
+static int replacement = REPLACE_NONE;
+module_param(replacement, int, 0444);
+MODULE_PARM_DESC(replacement, "Full sets of the set-associative backend: 0 = drop the new tuple, 1 = CLOCK, 2 = random");
+
+static int param_set_sets(const char* value, const struct kernel_param* kp);
+static const struct kernel_param_ops sets_param_ops = {
+	.set = param_set_sets,
+	.get = param_get_uint,
+};
+
+static uint initial_sets = INIT_HASH_ARGUMENT;
+module_param_cb(initial_sets, &sets_param_ops, &initial_sets, 0644);
+MODULE_PARM_DESC(initial_sets, "Sets of a new argument table, rounded up to a power of two with hash_function=1");
+
+static uint max_sets = MAX_HASH_ARGUMENT;
+module_param_cb(max_sets, &sets_param_ops, &max_sets, 0644);
+MODULE_PARM_DESC(max_sets, "Sets an argument table grows to at most, up to 597869");
+
+// Existing tables could no longer be looked up under another seed.
+static uint hash_seed = JHASH_INIT;
+module_param(hash_seed, uint, 0444);
+MODULE_PARM_DESC(hash_seed, "Initial value of the argument hash");
+
+static unsigned long cgroup_cache_kb;
+module_param(cgroup_cache_kb, ulong, 0644);
+MODULE_PARM_DESC(cgroup_cache_kb, "Most memory the caches of one memory cgroup may take, in KiB, 0 = no limit");
 
-DEFINE_SPINLOCK(draco_spinlock);
+static bool numa_rehome;
+module_param(numa_rehome, bool, 0644);
+MODULE_PARM_DESC(numa_rehome, "Move an argument table to the NUMA node it is looked up from");
 
 #ifdef METRICS_DRACO
-static int syscall_number[SYSCALL_COUNT] = {0};
+static DECLARE_BITMAP(syscall_seen, SYSCALL_COUNT);
 #endif
@@ -0,0 +1,851 @@
+/*
+ * Drives the real draco_module.c, built against kernel_stub.h, the way
+ * the patched seccomp would: draco_checker() first, and on a miss the
+ * filter's verdict handed to draco_record(). Filters are simulated: the
+ * verdict of a tuple is a function of the tuple and of the filter, and
+ * every hit is checked to be a tuple recorded before under the same
+ * filter and configuration, with that verdict. Options are name=value
+ * arguments, see struct options; draco_module_userspace_test.sh builds
+ * this and runs the usual set.
+ *
+ * threads=N runs N threads of one thread group at once, each a CPU of
+ * its own on alternating NUMA nodes, with a kworker running grow_work
+ * concurrently, to check that lock-free inserts, cuckoo displacement,
+ * growth and rehoming never hand out a wrong verdict.
+ *
+ * Exits non-zero on a false hit, a leaked allocation or css reference,
+ * or a cgroup over its budget.
+ */
+#include "kernel_stub.h"
+#include "../draco_module.c"
+
+static struct options {
+	long iterations;
+	long tasks; // Task slots, at most STUB_TASKS.
+	long syscalls; // Syscalls called, of each task.
+	long range; // Arguments are mostly below 8, a tenth below this.
+	long group; // Threads per thread group.
+	long threads; // Run threads concurrently instead, see above.
+	// One in that many calls...
+	long fork_rate; // ...forks a task into another's slot.
+	long exit_rate; // ...exits the task, a thread of its group takes the slot.
+	long filter_rate; // ...installs a filter on the task.
+	long tsync_rate; // ...installs one on the whole thread group.
+	long config_rate; // ...changes the Draco configuration of the task.
+	// Arguments.
+	long shift; // The first argument drifts by 1000 each that many calls.
+	long noisy; // Syscall 1 gets a random first argument.
+	long mask; // Syscalls 4n+1 get random high bits in the first argument...
+	long nomask; // ...and without this, are configured to mask them.
+	long cuts; // Syscalls 4n+2 get a first argument below 4096...
+	long nocuts; // ...and without this, are configured with two cuts.
+	long numa; // The task moves to the other node each that many calls.
+	// Reports.
+	long export; // Feed every exported tuple back to the checker.
+	long stats; // Read the stats, processes and syscalls files.
+	long cgroups; // Read the cgroups file and check the budgets.
+	// Module parameters.
+	long backend;
+	long hash;
+	long replace;
+	long bypass;
+	long rehome;
+	long cgroup_kb;
+	long initial_sets;
+	long max_sets;
+	long seed;
+} options = {
+	.iterations = 2000000,
+	.tasks = 8,
+	.syscalls = 20,
+	.range = 64,
+	.group = 1,
+	.backend = -1,
+	.hash = -1,
+	.replace = -1,
+	.bypass = -1,
+	.initial_sets = -1,
+	.max_sets = -1,
+	.seed = -1,
+};
+
+#define OPTION(name) { #name, &options.name }
+
+static const struct option_name {
+	const char* name;
+	long* value;
+} option_names[] = {
+	OPTION(iterations), OPTION(tasks), OPTION(syscalls), OPTION(range),
+	OPTION(group), OPTION(threads), OPTION(fork_rate), OPTION(exit_rate),
+	OPTION(filter_rate), OPTION(tsync_rate), OPTION(config_rate), OPTION(shift), OPTION(noisy),
+	OPTION(mask), OPTION(nomask), OPTION(cuts), OPTION(nocuts),
+	OPTION(numa), OPTION(backend), OPTION(hash), OPTION(replace),
+	OPTION(bypass), OPTION(rehome), OPTION(export), OPTION(stats),
+	OPTION(cgroups), OPTION(cgroup_kb), OPTION(initial_sets),
+	OPTION(max_sets), OPTION(seed),
+};
+
+static int parse_options(int argc, char** argv) {
+	size_t i;
+	int arg;
+
+	for (arg = 1; arg < argc; ++arg) {
+		const char* equal = strchr(argv[arg], '=');
+
+		for (i = 0; i < ARRAY_SIZE(option_names); ++i) {
+			if (equal != NULL && strlen(option_names[i].name) == (size_t)(equal - argv[arg]) &&
+				strncmp(argv[arg], option_names[i].name, equal - argv[arg]) == 0) {
+				*option_names[i].value = atol(equal + 1);
+				break;
+			}
+		}
+		if (i == ARRAY_SIZE(option_names)) {
+			fprintf(stderr, "unknown option %s\n", argv[arg]);
+			return -1;
+		}
+	}
+	if (options.tasks < 1 || options.tasks > STUB_TASKS || options.group < 1 ||
+		options.syscalls < 1 || options.syscalls > SYSCALL_COUNT ||
+		options.threads < 0 || options.threads >= STUB_NR_CPUS ||
+		options.threads > options.tasks) {
+		fprintf(stderr, "bad tasks, group, syscalls or threads\n");
+		return -1;
+	}
+	return 0;
+}
+
+// Through its setter, as a write to /sys/module/draco_module/parameters would.
+static void set_sets_parameter(const char* name, long value, uint* sets) {
+	struct kernel_param kp = { .arg = sets };
+	char buffer[32];
+
+	snprintf(buffer, sizeof(buffer), "%ld", value);
+	if (sets_param_ops.set(buffer, &kp) != 0) {
+		printf("%s=%ld rejected\n", name, value);
+	}
+}
+
+static void apply_module_parameters(void) {
+	if (options.backend >= 0) {
+		backend = options.backend;
+	}
+	if (options.hash >= 0) {
+		hash_function = options.hash;
+	}
+	if (options.replace >= 0) {
+		replacement = options.replace;
+	}
+	if (options.bypass >= 0) {
+		bypass_hit_percent = options.bypass;
+	}
+	if (options.initial_sets >= 0) {
+		set_sets_parameter("initial_sets", options.initial_sets, &initial_sets);
+	}
+	if (options.max_sets >= 0) {
+		set_sets_parameter("max_sets", options.max_sets, &max_sets);
+	}
+	if (options.seed >= 0) {
+		hash_seed = options.seed;
+	}
+	numa_rehome = options.rehome != 0;
+	cgroup_cache_kb = options.cgroup_kb;
+}
+
+/* The hooks draco.patch adds to seccomp.c, empty until the module loads */
+
+static int empty_draco(int syscall, struct pt_regs* regs, u32* filter_ret) {
+	return 0;
+}
+
+static void empty_draco_record(int syscall, struct pt_regs* regs, u32 filter_ret) {
+}
+
+static void empty_draco_release(struct task_struct* task) {
+}
+
+static void empty_draco_fork(struct task_struct* task) {
+	task->seccomp.draco_hook = NULL;
+	task->seccomp.draco_parent = NULL;
+}
+
+int (*draco_checker)(int, struct pt_regs*, u32*) = empty_draco;
+int (*draco_checker_backup)(int, struct pt_regs*, u32*) = empty_draco;
+void (*draco_record)(int, struct pt_regs*, u32) = empty_draco_record;
+void (*draco_record_backup)(int, struct pt_regs*, u32) = empty_draco_record;
+void (*draco_release)(struct task_struct*) = empty_draco_release;
+void (*draco_release_backup)(struct task_struct*) = empty_draco_release;
+void (*draco_fork)(struct task_struct*) = empty_draco_fork;
+void (*draco_fork_backup)(struct task_struct*) = empty_draco_fork;
+
+void get_seccomp_draco(struct seccomp_draco_config* config) {
+	if (config != NULL) {
+		atomic_inc(&config->usage);
+	}
+}
+
+void put_seccomp_draco(struct seccomp_draco_config* config) {
+	if (config != NULL && atomic_dec_and_test(&config->usage)) {
+		kfree(config);
+	}
+}
+
+// As a Draco prctl finds it: copied if a task forked since shares it.
+static struct seccomp_draco_config* config_for_write(struct task_struct* task) {
+	struct seccomp_draco_config* config = task->seccomp.draco_config;
+	struct seccomp_draco_config* copy;
+
+	if (config != NULL && atomic_read(&config->usage) == 1) {
+		return config;
+	}
+	copy = kzalloc(sizeof(*copy), GFP_KERNEL);
+	if (config != NULL) {
+		memcpy(copy, config, sizeof(*copy));
+	}
+	atomic_set(&copy->usage, 1);
+	task->seccomp.draco_config = copy;
+	put_seccomp_draco(config);
+	return copy;
+}
+
+/*
+ * Every tuple recorded so far, keyed as key_of() says. Lock-free, so that
+ * the threads of threads=N share it; a tuple is added before it is
+ * recorded, so that a hit on it in another thread always finds it.
+ */
+#define SEEN_BITS 23
+static u64* seen;
+
+static u64 seen_slot(u64 key) {
+	return (key*0x9e3779b97f4a7c15ULL) >> (64 - SEEN_BITS);
+}
+
+static int seen_has(u64 key) {
+	u64 slot = seen_slot(key);
+	u64 found;
+
+	while ((found = __atomic_load_n(&seen[slot], __ATOMIC_ACQUIRE)) != 0) {
+		if (found == key) {
+			return 1;
+		}
+		slot = (slot + 1) & ((1ULL << SEEN_BITS) - 1);
+	}
+	return 0;
+}
+
+static void seen_add(u64 key) {
+	u64 slot = seen_slot(key);
+	u64 found = 0;
+	long probes = 0;
+
+	while (!__atomic_compare_exchange_n(&seen[slot], &found, key, 0,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+		if (found == key) {
+			return;
+		}
+		if (++probes == (1L << SEEN_BITS)) {
+			fprintf(stderr, "too many tuples, raise SEEN_BITS\n");
+			abort();
+		}
+		slot = (slot + 1) & ((1ULL << SEEN_BITS) - 1);
+		found = 0;
+	}
+}
+
+/*
+ * A filter is an instance number, that the task's seccomp.filter points
+ * to; a tuple seen by another filter or configuration is another key.
+ */
+static int instance[STUB_TASKS];
+static int next_instance = 1;
+static int generation;
+static struct signal_struct signals[STUB_TASKS];
+
+static u64 mix(u64 h) {
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+static int new_instance(void) {
+	return __atomic_fetch_add(&next_instance, 1, __ATOMIC_RELAXED);
+}
+
+static void install_filter(int task, int filter) {
+	instance[task] = filter;
+	stub_tasks[task].seccomp.filter = (struct seccomp_filter* )(long)filter;
+}
+
+// Syscall s takes s % 4 arguments.
+static int argument_count_of(int syscall) {
+	return syscall % 4;
+}
+
+// The bits of argument @j the filter compares.
+static unsigned long argument_mask_of(int syscall, int j) {
+	return options.mask && !options.nomask && syscall % 4 == 1 && j == 0 ? 0xff : ~0UL;
+}
+
+// Whether argument @j is only compared against the two cuts of the task.
+static int has_cuts(int syscall, int j) {
+	return options.cuts && !options.nocuts && syscall % 4 == 2 && j == 0;
+}
+
+// The tuple as the filter sees it.
+static u64 key_of(int task, int syscall, struct pt_regs* regs) {
+	unsigned long arguments[6] = { regs->di, regs->si, regs->dx, regs->r10, regs->r8, regs->r9 };
+	unsigned long* cuts = stub_tasks[task].seccomp.draco_config->draco_cuts;
+	u64 key = mix(instance[task]*1000003ULL + syscall);
+	unsigned long argument;
+	int j;
+
+	for (j = 0; j < argument_count_of(syscall); ++j) {
+		argument = arguments[j] & argument_mask_of(syscall, j);
+		// The lowest value of its interval, so that moving a cut changes the key.
+		if (has_cuts(syscall, j)) {
+			argument = argument >= cuts[1] ? cuts[1] : argument >= cuts[0] ? cuts[0] : 0;
+		}
+		key = mix(key ^ argument);
+	}
+	return key | 1;
+}
+
+// A fifth of the tuples get ERRNO, each with its own errno.
+static u32 verdict_of(u64 key) {
+	return key % 5 == 0 ? (SECCOMP_RET_ERRNO | (u32)(key % 4096)) : SECCOMP_RET_ALLOW;
+}
+
+// A new thread group, configured as draco_self_config would.
+static void configure_task(int task) {
+	struct task_struct* t = &stub_tasks[task];
+	struct seccomp_draco_config* config;
+	int syscall;
+	int j;
+
+	// What the slot held before is gone, as free_task() has it.
+	put_seccomp_draco(t->seccomp.draco_config);
+	memset(t, 0, sizeof(*t));
+	t->pid = 100 + task;
+	t->tgid = t->pid;
+	t->group_leader = t;
+	t->signal = &signals[task];
+	atomic_set(&t->signal->live, 1);
+	t->seccomp.draco_generation = ++generation;
+	config = config_for_write(t);
+	if (options.cuts) {
+		config->draco_cut_count = 2;
+		config->draco_cuts[0] = 16;
+		config->draco_cuts[1] = 1024;
+	}
+	for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+		t->seccomp.argument_count_table[syscall] = argument_count_of(syscall);
+		for (j = 0; j < argument_count_of(syscall); ++j) {
+			t->seccomp.sys2arguments[syscall][j] = j + 1;
+			config->draco[syscall].arg_mask[j] = argument_mask_of(syscall, j);
+			if (has_cuts(syscall, j)) {
+				config->draco[syscall].cut_count[j] = 2;
+			}
+		}
+	}
+	install_filter(task, new_instance());
+}
+
+// @parent clones @child into the slot of @task, as copy_process() does.
+static void clone_task(int task, int parent, struct task_struct* group_leader) {
+	struct task_struct* child = &stub_tasks[task];
+
+	current = &stub_tasks[parent];
+	put_seccomp_draco(child->seccomp.draco_config);
+	*child = stub_tasks[parent];
+	get_seccomp_draco(child->seccomp.draco_config);
+	child->pid = 100 + task;
+	child->group_leader = group_leader;
+	// *child was overwritten with the parent's, its own signal too.
+	child->signal = (group_leader == child) ? &signals[task] : group_leader->signal;
+	draco_fork(child);
+	instance[task] = instance[parent];
+	current = child;
+}
+
+static void random_arguments(struct pt_regs* regs, int syscall, long iteration, unsigned int* seed) {
+	int skew = rand_r(seed) % 10 ? 8 : options.range;
+
+	memset(regs, 0, sizeof(*regs));
+	regs->di = rand_r(seed) % skew;
+	regs->si = rand_r(seed) % skew;
+	regs->dx = rand_r(seed) % skew;
+	regs->r10 = rand_r(seed) % options.range;
+	if (options.shift) {
+		regs->di += iteration/options.shift*1000;
+	}
+	if (options.noisy && syscall == 1) {
+		regs->di = rand_r(seed);
+	}
+	if (options.cuts && syscall % 4 == 2) {
+		regs->di = rand_r(seed) % 4096;
+	}
+	if (options.mask && syscall % 4 == 1) {
+		regs->di = ((unsigned long)rand_r(seed) << 8) | (regs->di & 0xff);
+	}
+}
+
+typedef struct tally {
+	long calls;
+	long hits;
+	long false_hits;
+} tally_type;
+
+// One syscall of current, in the slot of @task.
+static void call(int task, int syscall, struct pt_regs* regs, tally_type* tally) {
+	u64 key = key_of(task, syscall, regs);
+	u32 verdict;
+
+	tally->calls++;
+	if (draco_checker(syscall, regs, &verdict)) {
+		tally->hits++;
+		if (!seen_has(key) || verdict != verdict_of(key)) {
+			if (tally->false_hits++ < 5) {
+				printf("FALSE HIT task %d syscall %d verdict %x\n", task, syscall, verdict);
+			}
+		}
+		return;
+	}
+	seen_add(key);
+	draco_record(syscall, regs, verdict_of(key));
+}
+
+static void simulate(tally_type* tally) {
+	unsigned int seed = 1;
+	struct pt_regs regs;
+	long iteration;
+	long forks = 0;
+	int group = options.group;
+	int task;
+	int syscall;
+	int leader;
+	int other;
+	int filter;
+	int j;
+
+	for (task = 0; task < options.tasks; ++task) {
+		leader = task - task % group;
+		if (task == leader) {
+			configure_task(task);
+			current = &stub_tasks[task];
+			memset(&regs, 0, sizeof(regs));
+			call(task, 0, &regs, tally);
+		} else {
+			clone_task(task, leader, &stub_tasks[leader]);
+		}
+	}
+
+	for (iteration = 0; iteration < options.iterations; ++iteration) {
+		task = rand_r(&seed) % options.tasks;
+		syscall = rand_r(&seed) % options.syscalls;
+		leader = task - task % group;
+		current = &stub_tasks[task];
+		jiffies = iteration/1000 + 1;
+		if (options.numa) {
+			stub_cpu_node[stub_cpu] = iteration/options.numa % STUB_NR_NODES;
+		}
+		random_arguments(&regs, syscall, iteration, &seed);
+		call(task, syscall, &regs, tally);
+
+		if (iteration % 1000 == 0) {
+			flush_workqueue(hash_table.workqueue);
+			stub_quiesce();
+		}
+
+		if (options.fork_rate && rand_r(&seed) % options.fork_rate == 0) {
+			other = rand_r(&seed) % options.tasks;
+			if (other/group != task/group) {
+				draco_release(current);
+				clone_task(task, other, &stub_tasks[leader]);
+				forks++;
+			}
+		}
+		if (options.config_rate && rand_r(&seed) % options.config_rate == 0 &&
+			current->seccomp.draco_config->draco_cuts[0] + 1 <
+			current->seccomp.draco_config->draco_cuts[1]) {
+			config_for_write(current)->draco_cuts[0] += 1;
+			current->seccomp.draco_generation = ++generation;
+			instance[task] = new_instance();
+		}
+		if (options.filter_rate && rand_r(&seed) % options.filter_rate == 0) {
+			install_filter(task, new_instance());
+		}
+		if (options.tsync_rate && rand_r(&seed) % options.tsync_rate == 0) {
+			filter = new_instance();
+			for (j = leader; j < leader + group && j < options.tasks; ++j) {
+				if (stub_tasks[j].signal == current->signal) {
+					install_filter(j, filter);
+				}
+			}
+		}
+		if (options.exit_rate && rand_r(&seed) % options.exit_rate == 0) {
+			draco_release(current);
+			other = leader + (task - leader + 1) % group;
+			if (other == task || other >= options.tasks) {
+				configure_task(task);
+			} else {
+				clone_task(task, other, stub_tasks[other].group_leader);
+			}
+		}
+	}
+	printf("forks %ld\n", forks);
+}
+
+/* threads=N */
+
+static volatile int threads_running;
+
+typedef struct thread_state {
+	pthread_t thread;
+	int task;
+	tally_type tally;
+} thread_state_type;
+
+static void* kworker(void* unused) {
+	stub_cpu = options.threads;
+	while (READ_ONCE(threads_running)) {
+		if (!stub_run_work()) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void* group_thread(void* arg) {
+	thread_state_type* state = arg;
+	int task = state->task;
+	unsigned int seed = task + 1;
+	struct pt_regs regs;
+	long iteration;
+	int syscall;
+
+	stub_cpu = task;
+	current = &stub_tasks[task];
+	for (iteration = 0; iteration < options.iterations/options.threads; ++iteration) {
+		syscall = rand_r(&seed) % options.syscalls;
+		if (task == 0) {
+			jiffies = iteration/1000 + 1;
+		}
+		random_arguments(&regs, syscall, iteration, &seed);
+		call(task, syscall, &regs, &state->tally);
+
+		// The next call starts a cache of its own.
+		if (options.exit_rate && rand_r(&seed) % options.exit_rate == 0) {
+			draco_release(current);
+		}
+		if (options.filter_rate && rand_r(&seed) % options.filter_rate == 0) {
+			install_filter(task, new_instance());
+		}
+	}
+	return NULL;
+}
+
+static void simulate_threads(tally_type* tally) {
+	thread_state_type states[STUB_NR_CPUS];
+	struct pt_regs regs = { 0 };
+	pthread_t worker;
+	int task;
+
+	// The threads share the cache of the leader's first call.
+	configure_task(0);
+	current = &stub_tasks[0];
+	call(0, 0, &regs, tally);
+	for (task = 1; task < options.threads; ++task) {
+		clone_task(task, 0, &stub_tasks[0]);
+	}
+	for (task = 0; task < STUB_NR_CPUS; ++task) {
+		stub_cpu_node[task] = task % STUB_NR_NODES;
+	}
+
+	threads_running = 1;
+	pthread_create(&worker, NULL, kworker, NULL);
+	for (task = 0; task < options.threads; ++task) {
+		memset(&states[task], 0, sizeof(states[task]));
+		states[task].task = task;
+		pthread_create(&states[task].thread, NULL, group_thread, &states[task]);
+	}
+	for (task = 0; task < options.threads; ++task) {
+		pthread_join(states[task].thread, NULL);
+		tally->calls += states[task].tally.calls;
+		tally->hits += states[task].tally.hits;
+		tally->false_hits += states[task].tally.false_hits;
+	}
+	threads_running = 0;
+	pthread_join(worker, NULL);
+	stub_cpu = 0;
+	flush_workqueue(hash_table.workqueue);
+	stub_quiesce();
+}
+
+/* Reports */
+
+// Every tuple exported must hit again, with its verdict.
+static long check_export(void) {
+	struct seccomp_data* entry;
+	struct pt_regs regs;
+	long exported = 0;
+	long again = 0;
+	long wrong = 0;
+	size_t e;
+	int task;
+	u32 verdict;
+
+	for (task = 0; task < options.tasks; ++task) {
+		if (export_task(&stub_tasks[task]) != 0) {
+			continue;
+		}
+		current = &stub_tasks[task];
+		for (e = 0; e < export_count; ++e) {
+			entry = &export_entries[e];
+			memset(&regs, 0, sizeof(regs));
+			regs.di = entry->args[0];
+			regs.si = entry->args[1];
+			regs.dx = entry->args[2];
+			regs.r10 = entry->args[3];
+			regs.r8 = entry->args[4];
+			regs.r9 = entry->args[5];
+			exported++;
+			if (draco_checker(entry->nr, &regs, &verdict)) {
+				u64 key = key_of(task, entry->nr, &regs);
+
+				again++;
+				if (!seen_has(key) || verdict != verdict_of(key)) {
+					wrong++;
+				}
+			}
+		}
+	}
+	printf("exported %ld hit again %ld wrong %ld\n", exported, again, wrong);
+	return wrong;
+}
+
+// Lines of the processes and syscalls files, restarting every @restart.
+static long registry_lines(struct seq_file* m, long restart) {
+	int (*show[2])(struct seq_file*, void*) = { processes_seq_show, syscalls_seq_show };
+	long lines = 0;
+	loff_t position;
+	void* v;
+	int file;
+
+	for (file = 0; file < 2; ++file) {
+		position = 0;
+		v = registry_seq_start(m, &position);
+		while (v != NULL) {
+			show[file](m, v);
+			lines++;
+			if (restart && lines % restart == 0) {
+				registry_seq_stop(m, v);
+				v = registry_seq_start(m, &position);
+			}
+			v = registry_seq_next(m, v, &position);
+		}
+		registry_seq_stop(m, v);
+	}
+	return lines;
+}
+
+// Lines of the syscalls file whose bypassing column is set.
+static long bypassing_lines(void) {
+	struct seq_file m;
+	char* text = NULL;
+	size_t size = 0;
+	char* line;
+	long count = 0;
+	int bypass;
+	loff_t position = 0;
+	void* v;
+
+	m.out = open_memstream(&text, &size);
+	for (v = registry_seq_start(&m, &position); v != NULL; v = registry_seq_next(&m, v, &position)) {
+		syscalls_seq_show(&m, v);
+	}
+	registry_seq_stop(&m, v);
+	fclose(m.out);
+	for (line = strtok(text, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+		if (sscanf(line, "%*d %*d %*d %*d %*u %*u %*u %d", &bypass) == 1 && bypass) {
+			count++;
+		}
+	}
+	free(text);
+	return count;
+}
+
+// A read that restarts mid-way must list the same lines, a reset zero them,
+// and no syscall may still show as bypassing once every period ran out.
+static long check_stats(void) {
+	struct seq_file m = { stdout };
+	struct seq_file quiet = { fopen("/dev/null", "w") };
+	long lines;
+	long restarted;
+	long bypassing;
+	long expired;
+
+	stats_show(&m, NULL);
+	lines = registry_lines(&quiet, 0);
+	restarted = registry_lines(&quiet, 7);
+	bypassing = bypassing_lines();
+	jiffies += (BYPASS_PERIOD << BYPASS_MAX_SHIFT) + 1;
+	expired = bypassing_lines();
+	reset_metrics(&hash_table);
+	printf("after reset:\n");
+	stats_show(&m, NULL);
+	fclose(quiet.out);
+	printf("registry lines %ld, %ld when restarted\n", lines, restarted);
+	printf("bypassing %ld, %ld once expired\n", bypassing, expired);
+	return lines != restarted || METRICS_SUM(hash_table.metrics, total_call_count) != 0 ||
+		expired != 0;
+}
+
+// The bytes charged must be what the live tables take, within budget.
+static long check_cgroups(void) {
+	struct seq_file m = { stdout };
+	hash_table_per_process_type* per_process;
+	hash_table_per_process_per_syscall_type* sys;
+	draco_cgroup_type* cgroup;
+	unsigned long ways;
+	long charged = 0;
+	long listed = 0;
+	long over = 0;
+	int bucket;
+	int syscall;
+
+	// Caches that died are charged until their grace period and work item.
+	stub_quiesce();
+	flush_workqueue(hash_table.workqueue);
+	stub_quiesce();
+	cgroups_show(&m, NULL);
+	hash_for_each_rcu(draco_cgroups, bucket, cgroup, node) {
+		charged += atomic_long_read(&cgroup->bytes);
+		if (cgroup_cache_kb != 0 && atomic_long_read(&cgroup->bytes) > (long)cgroup_cache_kb*1024) {
+			over++;
+		}
+	}
+	for (per_process = registry_first(0); per_process != NULL;
+		per_process = registry_next(per_process)) {
+
+		listed += sizeof(*per_process);
+		for (syscall = 0; syscall < SYSCALL_COUNT; ++syscall) {
+			sys = per_process->syscall_table[syscall];
+			if (sys == NULL) {
+				continue;
+			}
+			ways = 0;
+			listed += syscall_table_bytes(sys, &ways);
+			if (sys->grown != NULL) {
+				listed += argument_table_footprint(sys->grown->size, sys->grown->argument_count);
+			}
+		}
+	}
+	printf("cgroup bytes %ld listed %ld over budget %ld\n", charged, listed, over);
+	// The work items ran on this thread, and must have switched back.
+	printf("memcg allocations %ld, left active %d\n", stub_memcg_allocations,
+		stub_active_memcg() != NULL);
+	return over + (charged != listed) + (stub_active_memcg() != NULL);
+}
+
+#ifdef LATENCY_DRACO
+// Every lookup, filter run and insert must have been timed once.
+static long check_latency(tally_type* tally) {
+	struct seq_file quiet = { fopen("/dev/null", "w") };
+	u64 lookups = 0;
+	u64 filters = 0;
+	u64 inserts = 0;
+	loff_t position = 0;
+	void* v;
+	int bucket;
+	int syscall;
+
+	for (v = latency_seq_start(&quiet, &position); v != NULL;
+		v = latency_seq_next(&quiet, v, &position)) {
+
+		latency_seq_show(&quiet, v);
+		syscall = (long)v - 1;
+		for (bucket = 0; bucket < LATENCY_BUCKETS; ++bucket) {
+			lookups += latency_sum(syscall, LATENCY_HIT, bucket) +
+				latency_sum(syscall, LATENCY_MISS, bucket);
+			filters += latency_sum(syscall, LATENCY_FILTER, bucket);
+			inserts += latency_sum(syscall, LATENCY_INSERT, bucket);
+		}
+	}
+	latency_seq_stop(&quiet, v);
+	fclose(quiet.out);
+	printf("timed lookups %llu filters %llu inserts %llu\n",
+		(unsigned long long)lookups, (unsigned long long)filters, (unsigned long long)inserts);
+	return lookups != (u64)tally->calls || filters != (u64)(tally->calls - tally->hits) ||
+		inserts != filters;
+}
+#endif
+
+int main(int argc, char** argv) {
+	tally_type tally = { 0 };
+	long failures = 0;
+	int configs = 0;
+	int task;
+	int other;
+
+	if (parse_options(argc, argv) != 0) {
+		return 2;
+	}
+	seen = calloc(1UL << SEEN_BITS, sizeof(u64));
+	apply_module_parameters();
+	if (draco_init() != 0) {
+		printf("draco_init failed\n");
+		return 1;
+	}
+
+	if (options.threads) {
+		simulate_threads(&tally);
+	} else {
+		simulate(&tally);
+	}
+	printf("hits %ld / %ld (%.1f%%) false %ld\n", tally.hits, tally.calls,
+		100.0*tally.hits/tally.calls, tally.false_hits);
+	printf("caches %lu\n", METRICS_SUM(hash_table.metrics, total_process_count));
+	printf("local %lu remote %lu rehomed %lu\n",
+		METRICS_SUM(hash_table.metrics, total_local_call_count),
+		METRICS_SUM(hash_table.metrics, total_remote_call_count),
+		METRICS_SUM(hash_table.metrics, total_rehome_count));
+	printf("bypassed %lu\n", METRICS_SUM(hash_table.metrics, total_bypass_count));
+	failures += tally.false_hits;
+
+	// Before the export check adds lookups of its own.
+	#ifdef LATENCY_DRACO
+		failures += check_latency(&tally);
+	#endif
+	if (options.export) {
+		failures += check_export();
+	}
+	if (options.stats) {
+		failures += check_stats();
+	}
+	if (options.cgroups) {
+		failures += check_cgroups();
+	}
+
+	draco_exit();
+	// Configurations are shared since fork, until one side changes its own.
+	for (task = 0; task < options.tasks; ++task) {
+		for (other = 0; other < task; ++other) {
+			if (stub_tasks[other].seccomp.draco_config == stub_tasks[task].seccomp.draco_config) {
+				break;
+			}
+		}
+		configs += other == task;
+	}
+	printf("draco configs %d for %ld tasks\n", configs, options.tasks);
+	for (task = 0; task < STUB_TASKS; ++task) {
+		put_seccomp_draco(stub_tasks[task].seccomp.draco_config);
+	}
+	printf("css refs %d, tried %d\n", atomic_read(&stub_css_refs), atomic_read(&stub_css_trygets));
+	printf("leaked allocations %ld\n", stub_allocations);
+	failures += atomic_read(&stub_css_refs) != 0;
+	failures += stub_allocations != 0;
+	free(seen);
+	return failures != 0;
+}
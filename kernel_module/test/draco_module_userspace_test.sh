@@ -0,0 +1,83 @@
+#!/bin/bash
+# Builds draco_module.c into draco_module_userspace_test.c with AddressSanitizer
+# and UBSan, and runs the simulations below; stops at the first one with a
+# false hit, a leak or a sanitizer report. Arguments are passed to the
+# compiler, e.g. -DLATENCY_DRACO.
+set -e
+cd "$(dirname "$0")"
+build=$(mktemp -d)
+trap 'rm -rf "$build"' EXIT
+
+# kernel_stub.h stands for every kernel header.
+for header in $(sed -n 's/^[[:space:]]*#include <\(linux\/[^>]*\|asm\/[^>]*\)>.*/\1/p' ../draco_module.c ../draco_module.h | sort -u); do
+	mkdir -p "$build/$(dirname "$header")"
+	touch "$build/$header"
+done
+
+compile() {
+	gcc -fgnu89-inline -O1 -g -pthread -fsanitize=address,undefined -fno-sanitize-recover=all \
+		-Werror=implicit-function-declaration \
+		-I"$build" -include kernel_stub.h "$@" \
+		kernel_stub.c draco_module_userspace_test.c -o "$build/draco_module_userspace_test"
+}
+
+compile "$@"
+
+run() {
+	echo "== $*"
+	"$build/draco_module_userspace_test" iterations=1000000 "$@"
+}
+
+run
+run backend=1
+run hash=1
+run hash=1 backend=1
+run shift=50000
+run shift=50000 replace=1
+run shift=50000 replace=2
+run shift=50000 replace=1 range=4096 initial_sets=64 max_sets=64 threads=4 tasks=4
+run noisy=1
+run noisy=1 bypass=0
+run mask=1
+run mask=1 nomask=1
+run cuts=1
+run cuts=1 nocuts=1
+run fork_rate=500 exit_rate=700 config_rate=3000 filter_rate=3000 cuts=1
+run group=4 tasks=16 fork_rate=500 exit_rate=500 config_rate=3000 cuts=1
+run numa=100000
+run numa=100000 rehome=1
+run numa=2000 rehome=1
+run group=4 tasks=16 fork_rate=500 exit_rate=500
+run group=4 tasks=16 fork_rate=500 exit_rate=500 backend=1
+run group=4 tasks=16 tsync_rate=2000 exit_rate=500
+run group=4 tasks=16 tsync_rate=2000 exit_rate=500 backend=1
+run export=1 mask=1 cuts=1 group=4 tasks=16 fork_rate=500 exit_rate=500
+run export=1 cuts=1 config_rate=3000
+run stats=1 mask=1 cuts=1 group=4 tasks=16 fork_rate=500 exit_rate=500
+run stats=1 backend=1 numa=100000 rehome=1
+run stats=1 noisy=1
+run cgroups=1
+run cgroups=1 cgroup_kb=64 syscalls=40 range=4096
+run cgroups=1 cgroup_kb=64 syscalls=40 range=4096 group=4 tasks=16 fork_rate=500 exit_rate=500
+run initial_sets=2 max_sets=64 syscalls=40 range=4096 cgroups=1
+run backend=1 initial_sets=2 max_sets=2 syscalls=40 range=4096 cgroups=1
+# Both setters refuse a table of fewer than two sets.
+test "$(run backend=1 initial_sets=1 max_sets=0 iterations=1000 | grep -c rejected)" = 2
+run initial_sets=4096 max_sets=100000 range=100000 cgroups=1
+run hash=1 initial_sets=100 seed=12345 cgroups=1
+run initial_sets=597869 max_sets=597869 syscalls=2 tasks=2 iterations=100000 cgroups=1
+run hash=1 backend=1 initial_sets=262144 max_sets=262144 range=1000000 syscalls=2 tasks=2 iterations=100000 cgroups=1
+run threads=4 tasks=4
+run threads=4 tasks=4 backend=1
+run threads=6 tasks=6 initial_sets=2 range=4096 exit_rate=2000 filter_rate=20000 rehome=1
+run threads=4 tasks=4 range=4096 cgroup_kb=256 cgroups=1
+run group=4 tasks=16 fork_rate=20 exit_rate=50
+run export=1 fork_rate=200
+
+# Kernels where grow_work charges its tables to their cgroup's memcg.
+for version in "4, 20, 0" "5, 10, 0"; do
+	compile "$@" "-DLINUX_VERSION_CODE=KERNEL_VERSION($version)"
+	run initial_sets=2 max_sets=64 syscalls=40 range=4096 cgroups=1
+	run cgroups=1 cgroup_kb=64 syscalls=40 range=4096 group=4 tasks=16 fork_rate=500 exit_rate=500
+done
+echo "all passed"
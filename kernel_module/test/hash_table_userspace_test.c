@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 static int malloc_count = 0;
 
@@ -345,8 +346,379 @@ void free_hash_table(
 	}
 }
 
+
+/*
+ * Layout benchmark: fills one per-syscall argument table with distinct
+ * tuples using the set-associative layout of draco_module.c and the cuckoo
+ * backend (two candidate sets, bounded kick chain, stash), then times
+ * lookups of present and absent tuples. Both run with a flag per way, and
+ * with the per-set tag word of the module, where a probe only reads the
+ * rows whose 16-bit fingerprint matched. Run with "layout" as argument.
+ */
+#define BENCH_SETS 1009
+#define BENCH_ASOS 4
+#define BENCH_ARGUMENTS 2
+#define BENCH_MAX_KICKS 16
+#define BENCH_STASH_SIZE 4
+#define BENCH_LOOKUPS 4000000
+#define BENCH_TAG_LANES 0x0001000100010001ULL
+#define BENCH_TAG_LOW_BITS 0x7fff7fff7fff7fffULL
+
+typedef struct bench_table {
+	unsigned long table[BENCH_SETS*BENCH_ASOS][BENCH_ARGUMENTS];
+	unsigned char flag[BENCH_SETS*BENCH_ASOS];
+	unsigned long long tags[BENCH_SETS];
+	unsigned long stash[BENCH_STASH_SIZE][BENCH_ARGUMENTS];
+	int stash_count;
+	int kick_way;
+	int cuckoo;
+	int tagged;
+	long probes;
+} bench_table_type;
+
+unsigned int bench_hash(unsigned long* argument_list) {
+	unsigned long h = 0x9e3779b97f4a7c15UL;
+	int index;
+	for (index = 0; index < BENCH_ARGUMENTS; ++index) {
+		h ^= argument_list[index];
+		h *= 0xff51afd7ed558ccdUL;
+		h ^= h >> 33;
+	}
+	return (unsigned int)h;
+}
+
+unsigned int bench_first_set(unsigned int hash_code) {
+	return hash_code % BENCH_SETS;
+}
+
+unsigned int bench_second_set(unsigned int hash_code) {
+	unsigned int first = hash_code % BENCH_SETS;
+	unsigned int second = (hash_code * 0x45d9f3bU ^ (hash_code >> 16)) % BENCH_SETS;
+	return (second != first) ? second : (first + 1) % BENCH_SETS;
+}
+
+unsigned short bench_tag(unsigned long* argument_list) {
+	unsigned short tag = bench_hash(argument_list) >> 16;
+	return tag >= 2 ? tag : tag + 2;
+}
+
+int bench_probe_set(bench_table_type* t, unsigned int set, unsigned long* argument_list) {
+	int index;
+	t->probes += 1;
+	if (t->tagged) {
+		unsigned long long x = t->tags[set] ^ (BENCH_TAG_LANES*bench_tag(argument_list));
+		unsigned long long match = ~(((x & BENCH_TAG_LOW_BITS) + BENCH_TAG_LOW_BITS) | 
+			x | BENCH_TAG_LOW_BITS);
+		while (match) {
+			index = __builtin_ctzll(match) >> 4;
+			if (memcmp(argument_list, t->table[set*BENCH_ASOS+index], 
+				sizeof(unsigned long)*BENCH_ARGUMENTS) == 0) {
+				return 1;
+			}
+			match &= match - 1;
+		}
+		return 0;
+	}
+	for (index = 0; index < BENCH_ASOS && t->flag[set*BENCH_ASOS+index]; ++index) {
+		if (memcmp(argument_list, t->table[set*BENCH_ASOS+index], 
+			sizeof(unsigned long)*BENCH_ARGUMENTS) == 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int bench_place_in_set(bench_table_type* t, unsigned int set, unsigned long* argument_list) {
+	int index;
+	for (index = 0; index < BENCH_ASOS; ++index) {
+		if (t->flag[set*BENCH_ASOS+index] == 0) {
+			memcpy(t->table[set*BENCH_ASOS+index], argument_list, 
+				sizeof(unsigned long)*BENCH_ARGUMENTS);
+			t->flag[set*BENCH_ASOS+index] = 1;
+			((unsigned short*)&t->tags[set])[index] = bench_tag(argument_list);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int bench_lookup(bench_table_type* t, unsigned long* argument_list) {
+	unsigned int hash_code = bench_hash(argument_list);
+	int index;
+
+	if (bench_probe_set(t, bench_first_set(hash_code), argument_list))
+		return 1;
+	if (!t->cuckoo)
+		return 0;
+	if (bench_probe_set(t, bench_second_set(hash_code), argument_list))
+		return 1;
+	for (index = 0; index < t->stash_count; ++index) {
+		if (memcmp(argument_list, t->stash[index], 
+			sizeof(unsigned long)*BENCH_ARGUMENTS) == 0)
+			return 1;
+	}
+	return 0;
+}
+
+/* Returns 0 when a tuple had to be dropped. */
+int bench_insert(bench_table_type* t, unsigned long* argument_list) {
+	unsigned long carry[BENCH_ARGUMENTS], victim[BENCH_ARGUMENTS];
+	unsigned int hash_code = bench_hash(argument_list);
+	unsigned int set = bench_first_set(hash_code);
+	int kick;
+
+	if (bench_place_in_set(t, set, argument_list))
+		return 1;
+	if (!t->cuckoo)
+		return 0;
+	if (bench_place_in_set(t, bench_second_set(hash_code), argument_list))
+		return 1;
+
+	memcpy(carry, argument_list, sizeof(carry));
+	for (kick = 0; kick < BENCH_MAX_KICKS; ++kick) {
+		unsigned int position = set*BENCH_ASOS + t->kick_way;
+		unsigned long* row = t->table[position];
+		unsigned int victim_hash;
+
+		t->kick_way = (t->kick_way + 1) % BENCH_ASOS;
+		memcpy(victim, row, sizeof(victim));
+		memcpy(row, carry, sizeof(carry));
+		((unsigned short*)t->tags)[position] = bench_tag(carry);
+		memcpy(carry, victim, sizeof(carry));
+
+		victim_hash = bench_hash(carry);
+		set = (set == bench_first_set(victim_hash)) ? 
+			bench_second_set(victim_hash) : bench_first_set(victim_hash);
+		if (bench_place_in_set(t, set, carry))
+			return 1;
+	}
+
+	if (t->stash_count < BENCH_STASH_SIZE) {
+		memcpy(t->stash[t->stash_count], carry, sizeof(carry));
+		t->stash_count += 1;
+		return 1;
+	}
+	return 0;
+}
+
+double bench_elapsed_ns(struct timespec* begin, struct timespec* end) {
+	return (end->tv_sec - begin->tv_sec) * 1e9 + (end->tv_nsec - begin->tv_nsec);
+}
+
+void bench_layout(int cuckoo, int tagged) {
+	static bench_table_type t;
+	static unsigned long tuples[BENCH_SETS*BENCH_ASOS*2][BENCH_ARGUMENTS];
+	int capacity = BENCH_SETS*BENCH_ASOS;
+	int occupied = 0, first_drop = -1, dropped = 0;
+	int attempts, index, hits = 0;
+	struct timespec begin, end;
+	double hit_ns, miss_ns;
+
+	memset(&t, 0, sizeof(t));
+	t.cuckoo = cuckoo;
+	t.tagged = tagged;
+	srand(7);
+
+	/* Distinct tuples: the first argument is the sequence number. */
+	for (attempts = 0; attempts < capacity; ++attempts) {
+		tuples[attempts][0] = attempts;
+		tuples[attempts][1] = rand();
+		/* A drop loses one tuple: the new one, or a resident for cuckoo. */
+		if (!bench_insert(&t, tuples[attempts])) {
+			if (first_drop < 0)
+				first_drop = attempts;
+			++dropped;
+		}
+	}
+	occupied = attempts - dropped;
+
+	t.probes = 0;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (index = 0; index < BENCH_LOOKUPS; ++index)
+		hits += bench_lookup(&t, tuples[index % capacity]);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	hit_ns = bench_elapsed_ns(&begin, &end) / BENCH_LOOKUPS;
+	printf("%-16s %-6s first drop at load %5.1f%%, load after %d inserts %5.1f%%, "
+		"hit rate %5.1f%%, %.2f sets/lookup, %.1f ns/lookup",
+		cuckoo ? "cuckoo" : "set-associative", tagged ? "tags" : "flags",
+		100.0 * (first_drop < 0 ? occupied : first_drop) / capacity,
+		capacity, 100.0 * occupied / capacity,
+		100.0 * hits / BENCH_LOOKUPS, (double)t.probes / BENCH_LOOKUPS, hit_ns);
+
+	for (index = 0; index < capacity; ++index)
+		tuples[capacity + index][0] = capacity + index;
+	t.probes = 0;
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (index = 0; index < BENCH_LOOKUPS; ++index)
+		hits += bench_lookup(&t, tuples[capacity + index % capacity]);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	miss_ns = bench_elapsed_ns(&begin, &end) / BENCH_LOOKUPS;
+	printf(", miss %.1f ns\n", miss_ns);
+}
+
+int bench_layouts(void) {
+	bench_layout(0, 0);
+	bench_layout(0, 1);
+	bench_layout(1, 0);
+	bench_layout(1, 1);
+	return 0;
+}
+
+/*
+ * Hash benchmark: set index of argument tuples of 1 to 6 words with
+ * jhash() modulo a prime table size, the default of draco_module.c, and
+ * with the multiply-xorshift word hash masked by a power-of-two size
+ * (hash_function=1). The tuples are structured like real arguments (small
+ * descriptors, flags, page-aligned pointers); the share of them dropped
+ * from full sets at 75% load checks that the word hash spreads them as
+ * well. Run with "hash" as argument.
+ */
+#define BENCH_HASH_TUPLES 4096
+#define BENCH_HASH_ROUNDS 2000
+#define BENCH_HASH_PRIME_SETS 149
+#define BENCH_HASH_POW2_SETS 128
+#define BENCH_JHASH_INIT 10000004
+#define BENCH_WORD_MULTIPLIER 0x9e3779b97f4a7c15UL
+
+#define bench_rol32(word, shift) (((word) << (shift)) | ((word) >> (32 - (shift))))
+
+#define bench_jhash_mix(a, b, c) {				\
+	a -= c;  a ^= bench_rol32(c, 4);  c += b;		\
+	b -= a;  b ^= bench_rol32(a, 6);  a += c;		\
+	c -= b;  c ^= bench_rol32(b, 8);  b += a;		\
+	a -= c;  a ^= bench_rol32(c, 16); c += b;		\
+	b -= a;  b ^= bench_rol32(a, 19); a += c;		\
+	c -= b;  c ^= bench_rol32(b, 4);  b += a;		\
+}
+
+#define bench_jhash_final(a, b, c) {				\
+	c ^= b; c -= bench_rol32(b, 14);			\
+	a ^= c; a -= bench_rol32(c, 11);			\
+	b ^= a; b -= bench_rol32(a, 25);			\
+	c ^= b; c -= bench_rol32(b, 16);			\
+	a ^= c; a -= bench_rol32(c, 4);				\
+	b ^= a; b -= bench_rol32(a, 14);			\
+	c ^= b; c -= bench_rol32(b, 24);			\
+}
+
+/* jhash() of include/linux/jhash.h, for a length that is a multiple of 4. */
+unsigned int bench_jhash(const void* key, unsigned int length, unsigned int initval) {
+	const unsigned int* k = key;
+	unsigned int a, b, c;
+
+	a = b = c = 0xdeadbeef + length + initval;
+	while (length > 12) {
+		a += k[0];
+		b += k[1];
+		c += k[2];
+		bench_jhash_mix(a, b, c);
+		length -= 12;
+		k += 3;
+	}
+	switch (length) {
+	case 12: c += k[2];	/* fall through */
+	case 8: b += k[1];	/* fall through */
+	case 4: a += k[0];
+		bench_jhash_final(a, b, c);
+		break;
+	case 0:
+		break;
+	}
+	return c;
+}
+
+unsigned int bench_hash_words(unsigned long* argument_list, int argument_count) {
+	unsigned long hash_code = BENCH_JHASH_INIT;
+	int index;
+
+	for (index = 0; index < argument_count; ++index) {
+		hash_code = (hash_code ^ argument_list[index])*BENCH_WORD_MULTIPLIER;
+		hash_code ^= hash_code >> 32;
+	}
+	return (unsigned int)hash_code;
+}
+
+unsigned int bench_jhash_set(unsigned long* argument_list, int argument_count) {
+	return bench_jhash(argument_list, sizeof(unsigned long)*argument_count, 
+		BENCH_JHASH_INIT) % BENCH_HASH_PRIME_SETS;
+}
+
+unsigned int bench_words_set(unsigned long* argument_list, int argument_count) {
+	return bench_hash_words(argument_list, argument_count) & (BENCH_HASH_POW2_SETS - 1);
+}
+
+double bench_hash_dropped(unsigned long (*tuples)[6], int argument_count, int sets,
+	unsigned int (*set_of)(unsigned long*, int)) {
+	static int occupancy[BENCH_HASH_PRIME_SETS];
+	int inserts = sets*BENCH_ASOS*3/4;
+	int dropped = 0;
+	int index;
+
+	memset(occupancy, 0, sizeof(occupancy));
+	for (index = 0; index < inserts; ++index) {
+		unsigned int set = set_of(tuples[index], argument_count);
+		if (occupancy[set] == BENCH_ASOS)
+			++dropped;
+		else
+			++occupancy[set];
+	}
+	return 100.0 * dropped / inserts;
+}
+
+double bench_hash_ns(unsigned long (*tuples)[6], int argument_count,
+	unsigned int (*set_of)(unsigned long*, int)) {
+	struct timespec begin, end;
+	volatile unsigned int sink = 0;
+	unsigned int sum = 0;
+	int round, index;
+
+	clock_gettime(CLOCK_MONOTONIC, &begin);
+	for (round = 0; round < BENCH_HASH_ROUNDS; ++round) {
+		for (index = 0; index < BENCH_HASH_TUPLES; ++index)
+			sum += set_of(tuples[index], argument_count);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	sink = sum;
+	(void)sink;
+	return bench_elapsed_ns(&begin, &end) / ((double)BENCH_HASH_ROUNDS*BENCH_HASH_TUPLES);
+}
+
+int bench_hashes(void) {
+	static unsigned long tuples[BENCH_HASH_TUPLES][6];
+	int argument_counts[] = {1, 2, 3, 6};
+	int index, word;
+
+	srand(11);
+	for (index = 0; index < BENCH_HASH_TUPLES; ++index) {
+		tuples[index][0] = index % 1024;
+		tuples[index][1] = 0x7f0000000000UL + 4096UL*(index/3);
+		tuples[index][2] = (index & 7) << 8;
+		for (word = 3; word < 6; ++word)
+			tuples[index][word] = rand() % 64;
+	}
+
+	for (index = 0; index < 4; ++index) {
+		int count = argument_counts[index];
+		printf("%d word(s): jhash %% %d %5.2f ns/set, %4.1f%% dropped; "
+			"word hash & %d %5.2f ns/set, %4.1f%% dropped\n", count,
+			BENCH_HASH_PRIME_SETS, bench_hash_ns(tuples, count, bench_jhash_set),
+			bench_hash_dropped(tuples, count, BENCH_HASH_PRIME_SETS, bench_jhash_set),
+			BENCH_HASH_POW2_SETS - 1, bench_hash_ns(tuples, count, bench_words_set),
+			bench_hash_dropped(tuples, count, BENCH_HASH_POW2_SETS, bench_words_set));
+	}
+	return 0;
+}
+
 int main(int argc, char const *argv[]) {
     
+    if (argc > 1 && strcmp(argv[1], "layout") == 0) {
+        return bench_layouts();
+    }
+
+    if (argc > 1 && strcmp(argv[1], "hash") == 0) {
+        return bench_hashes();
+    }
+    
     hash_table_type* hash_table = new_hash_table();
     key_type key;
 
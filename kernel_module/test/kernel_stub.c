@@ -0,0 +1,426 @@
+/*
+ * Definitions behind kernel_stub.h.
+ */
+#include "kernel_stub.h"
+
+__thread int stub_cpu;
+int stub_cpu_node[STUB_NR_CPUS];
+__thread struct task_struct* current;
+struct task_struct stub_tasks[STUB_TASKS];
+volatile unsigned long jiffies;
+long stub_allocations;
+
+int printk(const char* format, ...) {
+	va_list arguments;
+
+	if (getenv("DRACO_TEST_VERBOSE") == NULL) {
+		return 0;
+	}
+	va_start(arguments, format);
+	vprintf(format, arguments);
+	va_end(arguments);
+	return 0;
+}
+
+u32 jhash(const void* key, u32 length, u32 initval) {
+	const unsigned char* bytes = key;
+	u32 hash = initval ^ 0x9e3779b9;
+	u32 i;
+
+	for (i = 0; i < length; ++i) {
+		hash ^= bytes[i];
+		hash *= 0x01000193;
+		hash = rol32(hash, 13);
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	return hash;
+}
+
+u32 jhash2(const u32* key, u32 length, u32 initval) {
+	return jhash(key, length*sizeof(u32), initval);
+}
+
+u32 jhash_1word(u32 a, u32 initval) {
+	return jhash(&a, sizeof(a), initval);
+}
+
+u32 jhash_2words(u32 a, u32 b, u32 initval) {
+	u32 words[2] = { a, b };
+
+	return jhash(words, sizeof(words), initval);
+}
+
+u32 prandom_u32(void) {
+	static __thread unsigned int seed = 1;
+
+	seed += stub_cpu;
+	return (u32)rand_r(&seed);
+}
+
+void* memchr_inv(const void* start, int c, size_t bytes) {
+	const unsigned char* p = start;
+	size_t i;
+
+	for (i = 0; i < bytes; ++i) {
+		if (p[i] != (unsigned char)c) {
+			return (void* )(p + i);
+		}
+	}
+	return NULL;
+}
+
+/* Memory */
+
+void* kmalloc(size_t size, gfp_t flags) {
+	void* p = malloc(size ? size : 1);
+
+	if (p == NULL) {
+		return NULL;
+	}
+	__atomic_add_fetch(&stub_allocations, 1, __ATOMIC_RELAXED);
+	if ((flags & __GFP_ACCOUNT) && stub_active_memcg() != NULL) {
+		__atomic_add_fetch(&stub_memcg_allocations, 1, __ATOMIC_RELAXED);
+	}
+	if (flags & __GFP_ZERO) {
+		memset(p, 0, size);
+	}
+	return p;
+}
+
+void* kzalloc(size_t size, gfp_t flags) {
+	return kmalloc(size, flags | __GFP_ZERO);
+}
+
+void* kcalloc(size_t n, size_t size, gfp_t flags) {
+	return kzalloc(n*size, flags);
+}
+
+void kfree(const void* p) {
+	if (p != NULL) {
+		__atomic_sub_fetch(&stub_allocations, 1, __ATOMIC_RELAXED);
+		free((void* )p);
+	}
+}
+
+void* stub_alloc_percpu(size_t size) {
+	if (size > STUB_PERCPU_STRIDE) {
+		fprintf(stderr, "per-CPU object of %zu bytes, raise STUB_PERCPU_STRIDE\n", size);
+		abort();
+	}
+	return kzalloc(STUB_NR_CPUS*STUB_PERCPU_STRIDE, GFP_KERNEL);
+}
+
+void free_percpu(void* p) {
+	kfree(p);
+}
+
+struct kmem_cache {
+	size_t size;
+};
+
+struct kmem_cache* kmem_cache_create(const char* name, size_t size, size_t align,
+	unsigned long flags, void (*constructor)(void* object)) {
+
+	struct kmem_cache* cache = malloc(sizeof(struct kmem_cache));
+
+	cache->size = ALIGN(size, L1_CACHE_BYTES);
+	return cache;
+}
+
+void kmem_cache_destroy(struct kmem_cache* cache) {
+	free(cache);
+}
+
+void* kmem_cache_alloc(struct kmem_cache* cache, gfp_t flags) {
+	void* object = aligned_alloc(L1_CACHE_BYTES, cache->size);
+
+	if (object == NULL) {
+		return NULL;
+	}
+	__atomic_add_fetch(&stub_allocations, 1, __ATOMIC_RELAXED);
+	memset(object, (flags & __GFP_ZERO) ? 0 : 0xa5, cache->size);
+	return object;
+}
+
+void kmem_cache_free(struct kmem_cache* cache, void* object) {
+	kfree(object);
+}
+
+/* RCU: callbacks wait for stub_quiesce() */
+
+static pthread_mutex_t rcu_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct rcu_head* rcu_pending;
+
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head)) {
+	head->func = func;
+	pthread_mutex_lock(&rcu_lock);
+	head->next = rcu_pending;
+	rcu_pending = head;
+	pthread_mutex_unlock(&rcu_lock);
+}
+
+void stub_quiesce(void) {
+	struct rcu_head* head;
+
+	// Callbacks may queue more callbacks.
+	for (;;) {
+		pthread_mutex_lock(&rcu_lock);
+		head = rcu_pending;
+		rcu_pending = NULL;
+		pthread_mutex_unlock(&rcu_lock);
+		if (head == NULL) {
+			return;
+		}
+		while (head != NULL) {
+			struct rcu_head* next = head->next;
+
+			head->func(head);
+			head = next;
+		}
+	}
+}
+
+// Only called by the module at unload, with no reader left.
+void synchronize_rcu(void) {
+}
+
+void rcu_barrier(void) {
+	stub_quiesce();
+}
+
+/* Work items: run by whoever calls stub_run_work() */
+
+#define STUB_MAX_WORK 4096
+
+static pthread_mutex_t work_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct work_struct* work_pending[STUB_MAX_WORK];
+static int work_count;
+static struct work_struct* work_running;
+
+struct workqueue_struct* alloc_workqueue(const char* name, unsigned int flags, int max_active) {
+	struct workqueue_struct* workqueue = kzalloc(sizeof(*workqueue), GFP_KERNEL);
+
+	if (workqueue != NULL) {
+		workqueue->name = name;
+	}
+	return workqueue;
+}
+
+int queue_work(struct workqueue_struct* workqueue, struct work_struct* work) {
+	if (workqueue == NULL) {
+		fprintf(stderr, "work queued without a workqueue\n");
+		abort();
+	}
+	pthread_mutex_lock(&work_lock);
+	if (work->queued) {
+		pthread_mutex_unlock(&work_lock);
+		return 0;
+	}
+	if (work_count == STUB_MAX_WORK) {
+		fprintf(stderr, "more than %d work items pending\n", STUB_MAX_WORK);
+		abort();
+	}
+	work->queued = 1;
+	work_pending[work_count++] = work;
+	pthread_mutex_unlock(&work_lock);
+	return 1;
+}
+
+int stub_run_work(void) {
+	struct work_struct* work;
+
+	pthread_mutex_lock(&work_lock);
+	if (work_count == 0) {
+		pthread_mutex_unlock(&work_lock);
+		return 0;
+	}
+	work = work_pending[--work_count];
+	work->queued = 0;
+	work_running = work;
+	pthread_mutex_unlock(&work_lock);
+
+	work->func(work);
+
+	pthread_mutex_lock(&work_lock);
+	work_running = NULL;
+	pthread_mutex_unlock(&work_lock);
+	return 1;
+}
+
+void flush_workqueue(struct workqueue_struct* workqueue) {
+	while (stub_run_work()) {
+	}
+}
+
+void destroy_workqueue(struct workqueue_struct* workqueue) {
+	flush_workqueue(workqueue);
+	kfree(workqueue);
+}
+
+int cancel_work_sync(struct work_struct* work) {
+	int i;
+	int cancelled = 0;
+
+	pthread_mutex_lock(&work_lock);
+	for (i = 0; i < work_count; ++i) {
+		if (work_pending[i] == work) {
+			work_pending[i] = work_pending[--work_count];
+			work->queued = 0;
+			cancelled = 1;
+			break;
+		}
+	}
+	while (work_running == work) {
+		pthread_mutex_unlock(&work_lock);
+		sched_yield();
+		pthread_mutex_lock(&work_lock);
+	}
+	pthread_mutex_unlock(&work_lock);
+	return cancelled;
+}
+
+/* Tasks */
+
+struct pid* find_get_pid(int nr) {
+	return NULL;
+}
+
+struct task_struct* get_pid_task(struct pid* pid, enum pid_type type) {
+	return NULL;
+}
+
+void put_pid(struct pid* pid) {
+}
+
+void put_task_struct(struct task_struct* task) {
+}
+
+/* Memory cgroups */
+
+static struct cgroup stub_cgroups[3] = { { 0 }, { 1 }, { 2 } };
+static struct cgroup_subsys_state stub_css[3] = {
+	{ &stub_cgroups[0] }, { &stub_cgroups[1] }, { &stub_cgroups[2] },
+};
+atomic_t stub_css_refs;
+atomic_t stub_css_trygets;
+
+struct cgroup_subsys_state* task_css(struct task_struct* task, int subsys_id) {
+	return &stub_css[task->tgid % 3];
+}
+
+int css_tryget(struct cgroup_subsys_state* css) {
+	atomic_inc(&stub_css_trygets);
+	atomic_inc(&stub_css_refs);
+	atomic_inc(&css->refs);
+	return 1;
+}
+
+void css_put(struct cgroup_subsys_state* css) {
+	atomic_dec(&stub_css_refs);
+	atomic_dec(&css->refs);
+}
+
+int cgroup_path(struct cgroup* cgroup, char* buffer, size_t length) {
+	return snprintf(buffer, length, "/docker/c%d", cgroup->id);
+}
+
+static __thread struct mem_cgroup* active_memcg;
+long stub_memcg_allocations;
+
+struct mem_cgroup* set_active_memcg(struct mem_cgroup* memcg) {
+	struct mem_cgroup* old = active_memcg;
+
+	active_memcg = memcg;
+	return old;
+}
+
+void memalloc_use_memcg(struct mem_cgroup* memcg) {
+	active_memcg = memcg;
+}
+
+void memalloc_unuse_memcg(void) {
+	active_memcg = NULL;
+}
+
+struct mem_cgroup* stub_active_memcg(void) {
+	return active_memcg;
+}
+
+/* debugfs and seq_file: the test calls the show functions itself */
+
+struct dentry* debugfs_create_dir(const char* name, struct dentry* parent) {
+	return NULL;
+}
+
+struct dentry* debugfs_create_file(const char* name, umode_t mode, struct dentry* parent,
+	void* data, const struct file_operations* fops) {
+
+	return NULL;
+}
+
+void debugfs_remove_recursive(struct dentry* dentry) {
+}
+
+int seq_open(struct file* file, const struct seq_operations* ops) {
+	return 0;
+}
+
+ssize_t seq_read(struct file* file, char* buffer, size_t count, loff_t* position) {
+	return 0;
+}
+
+loff_t seq_lseek(struct file* file, loff_t offset, int whence) {
+	return 0;
+}
+
+int seq_release(struct inode* inode, struct file* file) {
+	return 0;
+}
+
+int single_open(struct file* file, int (*show)(struct seq_file* m, void* v), void* data) {
+	return 0;
+}
+
+int single_release(struct inode* inode, struct file* file) {
+	return 0;
+}
+
+loff_t default_llseek(struct file* file, loff_t offset, int whence) {
+	return 0;
+}
+
+ssize_t simple_read_from_buffer(void* to, size_t count, loff_t* position,
+	const void* from, size_t available) {
+
+	if (*position >= (loff_t)available) {
+		return 0;
+	}
+	if (count > available - *position) {
+		count = available - *position;
+	}
+	memcpy(to, (const char* )from + *position, count);
+	*position += count;
+	return count;
+}
+
+int param_get_uint(char* buffer, const struct kernel_param* kp) {
+	return sprintf(buffer, "%u\n", *(unsigned int* )kp->arg);
+}
+
+int kstrtouint(const char* value, unsigned int base, unsigned int* result) {
+	char* end;
+	unsigned long long parsed = strtoull(value, &end, base);
+
+	if (end == value || *end != '\0' || *value == '-' || parsed > 0xffffffffULL) {
+		return -EINVAL;
+	}
+	*result = parsed;
+	return 0;
+}
+
+int kstrtoint_from_user(const char* buffer, size_t count, unsigned int base, int* result) {
+	*result = (int)strtol(buffer, NULL, base);
+	return 0;
+}
@@ -0,0 +1,726 @@
+/*
+ * Userspace stand-ins for the kernel interfaces draco_module.c uses, so
+ * that draco_module_userspace_test.c can build the module as it is and
+ * drive it from a simulation. Force-included ahead of the module; the
+ * <linux/...> headers it includes are empty files made by
+ * draco_module_userspace_test.sh.
+ *
+ * Atomics, bit operations, cmpxchg(), spinlocks and seqcounts are real,
+ * so that several threads may run the lookup and insert paths at once.
+ * RCU is not: callbacks wait for stub_quiesce(), which the test calls
+ * only while no thread is inside the module, so a grace period always
+ * covers every reader. Each thread is a CPU of its own for per-CPU data.
+ */
+#ifndef KERNEL_STUB_H
+#define KERNEL_STUB_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifndef LINUX_VERSION_CODE
+#define LINUX_VERSION_CODE KERNEL_VERSION(4, 18, 0)
+#endif
+#define KERNEL_VERSION(a, b, c) (((a) << 16) + ((b) << 8) + (c))
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+typedef int32_t s32;
+typedef int64_t s64;
+typedef unsigned int gfp_t;
+typedef u64 cycles_t;
+
+#define __user
+#define __percpu
+#define __rcu
+#define __init
+#define __exit
+#define __read_mostly
+#define __aligned(x) __attribute__((aligned(x)))
+#define L1_CACHE_BYTES 64
+#define ____cacheline_aligned __aligned(L1_CACHE_BYTES)
+#define ____cacheline_aligned_in_smp __aligned(L1_CACHE_BYTES)
+#define likely(x) __builtin_expect(!!(x), 1)
+#define unlikely(x) __builtin_expect(!!(x), 0)
+#define BUILD_BUG_ON(condition) _Static_assert(!(condition), #condition)
+#define ARRAY_SIZE(a) (sizeof(a)/sizeof((a)[0]))
+#define container_of(ptr, type, member) ((type* )((char* )(ptr) - offsetof(type, member)))
+
+#define MODULE_LICENSE(license)
+#define MODULE_PARM_DESC(name, description)
+#define module_param(name, type, mode)
+#define module_param_named(name, value, type, mode)
+#define module_param_cb(name, ops, arg, mode)
+
+struct kernel_param {
+	void* arg;
+};
+
+struct kernel_param_ops {
+	int (*set)(const char* value, const struct kernel_param* kp);
+	int (*get)(char* buffer, const struct kernel_param* kp);
+};
+
+int param_get_uint(char* buffer, const struct kernel_param* kp);
+int kstrtouint(const char* value, unsigned int base, unsigned int* result);
+#define module_init(function)
+#define module_exit(function)
+#define EXPORT_SYMBOL(symbol)
+#define THIS_MODULE NULL
+
+#define KERN_ERR ""
+#define KERN_WARNING ""
+#define KERN_INFO ""
+#define KERN_DEBUG ""
+// Silent unless DRACO_TEST_VERBOSE is set in the environment.
+int printk(const char* format, ...);
+
+#define ENOENT 2
+#define ESRCH 3
+#define E2BIG 7
+#define ENOMEM 12
+#define EACCES 13
+#define EFAULT 14
+#define EINVAL 22
+#define IS_ERR_OR_NULL(p) ((p) == NULL)
+
+/* Arithmetic */
+
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#define min_t(type, a, b) min((type)(a), (type)(b))
+#define max_t(type, a, b) max((type)(a), (type)(b))
+#define clamp_t(type, value, low, high) min_t(type, max_t(type, value, low), high)
+#define ALIGN(x, a) (((x) + (a) - 1) & ~((__typeof__(x))(a) - 1))
+#define PTR_ALIGN(p, a) ((__typeof__(p))ALIGN((unsigned long)(p), (a)))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1)/(d))
+#define __ffs(x) __builtin_ctzl(x)
+#define fls64(x) ((x) ? 64 - __builtin_clzll(x) : 0)
+#define rol32(word, shift) (((word) << (shift)) | ((word) >> (32 - (shift))))
+
+static inline int is_power_of_2(unsigned long n) {
+	return n != 0 && (n & (n - 1)) == 0;
+}
+
+static inline unsigned long roundup_pow_of_two(unsigned long n) {
+	return n <= 1 ? 1 : 1UL << (64 - __builtin_clzl(n - 1));
+}
+
+static inline unsigned long rounddown_pow_of_two(unsigned long n) {
+	return 1UL << (63 - __builtin_clzl(n));
+}
+
+static inline int ilog2(unsigned long n) {
+	return 63 - __builtin_clzl(n);
+}
+
+// Not the kernel's jhash, only its spread matters here.
+u32 jhash(const void* key, u32 length, u32 initval);
+u32 jhash2(const u32* key, u32 length, u32 initval);
+u32 jhash_1word(u32 a, u32 initval);
+u32 jhash_2words(u32 a, u32 b, u32 initval);
+u32 prandom_u32(void);
+void* memchr_inv(const void* start, int c, size_t bytes);
+
+/* Memory ordering and atomics */
+
+#define barrier() __asm__ __volatile__("" ::: "memory")
+#define smp_mb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define smp_rmb() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define smp_wmb() __atomic_thread_fence(__ATOMIC_RELEASE)
+#define READ_ONCE(x) (*(volatile __typeof__(x)* )&(x))
+#define WRITE_ONCE(x, value) (*(volatile __typeof__(x)* )&(x) = (value))
+#define smp_load_acquire(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define smp_store_release(p, value) __atomic_store_n((p), (value), __ATOMIC_RELEASE)
+#define xchg(p, value) __atomic_exchange_n((p), (value), __ATOMIC_SEQ_CST)
+#define cmpxchg(p, old, new) ({						\
+	__typeof__(*(p)) __old = (old);					\
+	__atomic_compare_exchange_n((p), &__old, (new), 0,		\
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);			\
+	__old;								\
+})
+
+typedef struct { int counter; } atomic_t;
+typedef struct { long counter; } atomic_long_t;
+
+#define ATOMIC_INIT(i) { (i) }
+#define atomic_read(v) READ_ONCE((v)->counter)
+#define atomic_set(v, i) WRITE_ONCE((v)->counter, (i))
+#define atomic_add_return(i, v) __atomic_add_fetch(&(v)->counter, (i), __ATOMIC_SEQ_CST)
+#define atomic_sub_return(i, v) __atomic_sub_fetch(&(v)->counter, (i), __ATOMIC_SEQ_CST)
+#define atomic_inc(v) ((void)atomic_add_return(1, (v)))
+#define atomic_dec(v) ((void)atomic_sub_return(1, (v)))
+#define atomic_inc_return(v) atomic_add_return(1, (v))
+#define atomic_dec_and_test(v) (atomic_sub_return(1, (v)) == 0)
+#define atomic_cmpxchg(v, old, new) cmpxchg(&(v)->counter, (old), (new))
+#define atomic_long_read(v) atomic_read(v)
+#define atomic_long_set(v, i) atomic_set((v), (i))
+#define atomic_long_add_return(i, v) atomic_add_return((i), (v))
+#define atomic_long_add(i, v) ((void)atomic_add_return((i), (v)))
+#define atomic_long_sub(i, v) ((void)atomic_sub_return((i), (v)))
+#define atomic_long_inc(v) atomic_inc(v)
+
+static inline int atomic_add_unless(atomic_t* v, int a, int u) {
+	int c = atomic_read(v);
+
+	while (c != u) {
+		if (__atomic_compare_exchange_n(&v->counter, &c, c + a, 0,
+			__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+#define atomic_inc_not_zero(v) atomic_add_unless((v), 1, 0)
+
+/* Bit operations and bitmaps */
+
+#define BITS_PER_LONG 64
+#define BITS_TO_LONGS(bits) DIV_ROUND_UP(bits, BITS_PER_LONG)
+#define DECLARE_BITMAP(name, bits) unsigned long name[BITS_TO_LONGS(bits)]
+#define BIT_WORD(nr) ((nr)/BITS_PER_LONG)
+#define BIT_MASK(nr) (1UL << ((nr) % BITS_PER_LONG))
+
+static inline int test_bit(long nr, const volatile unsigned long* addr) {
+	return (addr[BIT_WORD(nr)] & BIT_MASK(nr)) != 0;
+}
+
+static inline void set_bit(long nr, volatile unsigned long* addr) {
+	__atomic_fetch_or(&addr[BIT_WORD(nr)], BIT_MASK(nr), __ATOMIC_SEQ_CST);
+}
+
+static inline void clear_bit(long nr, volatile unsigned long* addr) {
+	__atomic_fetch_and(&addr[BIT_WORD(nr)], ~BIT_MASK(nr), __ATOMIC_SEQ_CST);
+}
+
+static inline void change_bit(long nr, volatile unsigned long* addr) {
+	__atomic_fetch_xor(&addr[BIT_WORD(nr)], BIT_MASK(nr), __ATOMIC_SEQ_CST);
+}
+
+static inline int test_and_set_bit(long nr, volatile unsigned long* addr) {
+	return (__atomic_fetch_or(&addr[BIT_WORD(nr)], BIT_MASK(nr), __ATOMIC_SEQ_CST) &
+		BIT_MASK(nr)) != 0;
+}
+
+static inline int test_and_clear_bit(long nr, volatile unsigned long* addr) {
+	return (__atomic_fetch_and(&addr[BIT_WORD(nr)], ~BIT_MASK(nr), __ATOMIC_SEQ_CST) &
+		BIT_MASK(nr)) != 0;
+}
+
+static inline void bitmap_zero(unsigned long* bitmap, unsigned int bits) {
+	memset(bitmap, 0, BITS_TO_LONGS(bits)*sizeof(unsigned long));
+}
+
+static inline void bitmap_copy(unsigned long* to, const unsigned long* from, unsigned int bits) {
+	memcpy(to, from, BITS_TO_LONGS(bits)*sizeof(unsigned long));
+}
+
+#define for_each_set_bit(bit, addr, size)				\
+	for ((bit) = 0; (bit) < (size); (bit)++)			\
+		if (test_bit((bit), (addr)))
+
+/* CPUs, NUMA nodes and per-CPU data */
+
+#define STUB_NR_CPUS 8
+#define STUB_NR_NODES 2
+// Every per-CPU object takes this much per CPU, whatever its type.
+#define STUB_PERCPU_STRIDE 1024
+
+extern __thread int stub_cpu; // The CPU the calling thread stands for.
+extern int stub_cpu_node[STUB_NR_CPUS];
+
+#define nr_cpu_ids STUB_NR_CPUS
+#define cpu_possible_mask NULL
+#define cpumask_first(mask) 0
+#define cpumask_next(cpu, mask) ((cpu) + 1)
+#define for_each_possible_cpu(cpu) for ((cpu) = 0; (cpu) < STUB_NR_CPUS; (cpu)++)
+#define for_each_online_cpu(cpu) for_each_possible_cpu(cpu)
+#define for_each_online_node(node) for ((node) = 0; (node) < STUB_NR_NODES; (node)++)
+#define cpu_to_node(cpu) (stub_cpu_node[(cpu)])
+#define numa_node_id() cpu_to_node(stub_cpu)
+#define smp_processor_id() (stub_cpu)
+#define raw_smp_processor_id() (stub_cpu)
+#define get_cpu() (stub_cpu)
+#define put_cpu() do { } while (0)
+#define preempt_disable() do { } while (0)
+#define preempt_enable() do { } while (0)
+#define cond_resched() do { } while (0)
+
+void* stub_alloc_percpu(size_t size);
+void free_percpu(void* p);
+#define alloc_percpu(type) ((type* )stub_alloc_percpu(sizeof(type)))
+#define per_cpu_ptr(p, cpu) ((__typeof__(p))((char* )(p) + (cpu)*STUB_PERCPU_STRIDE))
+#define this_cpu_ptr(p) per_cpu_ptr((p), stub_cpu)
+#define get_cpu_ptr(p) this_cpu_ptr(p)
+#define put_cpu_ptr(p) ((void)(p))
+#define this_cpu_inc(x) ((*this_cpu_ptr(&(x)))++)
+#define this_cpu_add(x, value) ((*this_cpu_ptr(&(x))) += (value))
+#define DEFINE_PER_CPU(type, name) __typeof__(type) name[STUB_NR_CPUS]
+#define per_cpu(name, cpu) ((name)[cpu])
+#define get_cpu_var(name) ((name)[stub_cpu])
+#define put_cpu_var(name) do { } while (0)
+
+/* Locks */
+
+typedef struct { int locked; } spinlock_t;
+#define DEFINE_SPINLOCK(name) spinlock_t name = { 0 }
+
+static inline void spin_lock_init(spinlock_t* lock) {
+	lock->locked = 0;
+}
+
+static inline int spin_trylock(spinlock_t* lock) {
+	return !__atomic_test_and_set(&lock->locked, __ATOMIC_ACQUIRE);
+}
+
+static inline void spin_lock(spinlock_t* lock) {
+	while (!spin_trylock(lock)) {
+		sched_yield();
+	}
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+	__atomic_clear(&lock->locked, __ATOMIC_RELEASE);
+}
+
+#define lockdep_is_held(lock) 1
+
+static inline int atomic_dec_and_lock(atomic_t* v, spinlock_t* lock) {
+	if (atomic_add_unless(v, -1, 1)) {
+		return 0;
+	}
+	spin_lock(lock);
+	if (atomic_dec_and_test(v)) {
+		return 1;
+	}
+	spin_unlock(lock);
+	return 0;
+}
+
+struct mutex { pthread_mutex_t lock; };
+#define DEFINE_MUTEX(name) struct mutex name = { PTHREAD_MUTEX_INITIALIZER }
+#define mutex_lock(m) pthread_mutex_lock(&(m)->lock)
+#define mutex_unlock(m) pthread_mutex_unlock(&(m)->lock)
+
+typedef struct { unsigned int sequence; } seqcount_t;
+
+static inline void seqcount_init(seqcount_t* s) {
+	s->sequence = 0;
+}
+
+static inline unsigned int raw_read_seqcount_begin(const seqcount_t* s) {
+	return __atomic_load_n(&s->sequence, __ATOMIC_ACQUIRE);
+}
+
+static inline unsigned int read_seqcount_begin(const seqcount_t* s) {
+	unsigned int sequence;
+
+	while ((sequence = raw_read_seqcount_begin(s)) & 1) {
+		sched_yield();
+	}
+	return sequence;
+}
+
+static inline int read_seqcount_retry(const seqcount_t* s, unsigned int start) {
+	smp_rmb();
+	return __atomic_load_n(&s->sequence, __ATOMIC_RELAXED) != start;
+}
+
+static inline void raw_write_seqcount_begin(seqcount_t* s) {
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+	smp_wmb();
+}
+
+static inline void raw_write_seqcount_end(seqcount_t* s) {
+	smp_wmb();
+	__atomic_store_n(&s->sequence, s->sequence + 1, __ATOMIC_RELAXED);
+}
+
+#define write_seqcount_begin(s) raw_write_seqcount_begin(s)
+#define write_seqcount_end(s) raw_write_seqcount_end(s)
+
+/* RCU */
+
+struct rcu_head {
+	struct rcu_head* next;
+	void (*func)(struct rcu_head* head);
+};
+
+#define rcu_read_lock() do { } while (0)
+#define rcu_read_unlock() do { } while (0)
+#define rcu_dereference(p) READ_ONCE(p)
+#define rcu_dereference_protected(p, condition) (p)
+#define rcu_access_pointer(p) READ_ONCE(p)
+#define rcu_assign_pointer(p, value) smp_store_release(&(p), (value))
+#define RCU_INIT_POINTER(p, value) WRITE_ONCE((p), (value))
+void call_rcu(struct rcu_head* head, void (*func)(struct rcu_head* head));
+void synchronize_rcu(void);
+void rcu_barrier(void);
+// Run the RCU callbacks queued so far; only while no thread is in the module.
+void stub_quiesce(void);
+
+/* Lists */
+
+struct list_head { struct list_head *next, *prev; };
+struct hlist_head { struct hlist_node* first; };
+struct hlist_node { struct hlist_node *next, **pprev; };
+
+#define LIST_HEAD_INIT(name) { &(name), &(name) }
+#define LIST_HEAD(name) struct list_head name = LIST_HEAD_INIT(name)
+#define list_entry(ptr, type, member) container_of(ptr, type, member)
+#define list_for_each_entry(pos, head, member)					\
+	for (pos = list_entry((head)->next, __typeof__(*pos), member);		\
+		&pos->member != (head);						\
+		pos = list_entry(pos->member.next, __typeof__(*pos), member))
+#define list_for_each_entry_rcu(pos, head, member) list_for_each_entry(pos, head, member)
+#define list_for_each_entry_safe(pos, n, head, member)				\
+	for (pos = list_entry((head)->next, __typeof__(*pos), member),		\
+		n = list_entry(pos->member.next, __typeof__(*pos), member);	\
+		&pos->member != (head);						\
+		pos = n, n = list_entry(n->member.next, __typeof__(*n), member))
+
+static inline void INIT_LIST_HEAD(struct list_head* list) {
+	list->next = list;
+	list->prev = list;
+}
+
+static inline int list_empty(const struct list_head* head) {
+	return READ_ONCE(head->next) == head;
+}
+
+static inline void list_add(struct list_head* entry, struct list_head* head) {
+	entry->next = head->next;
+	entry->prev = head;
+	head->next->prev = entry;
+	smp_store_release(&head->next, entry);
+}
+
+static inline void list_del(struct list_head* entry) {
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+static inline void list_del_init(struct list_head* entry) {
+	list_del(entry);
+	INIT_LIST_HEAD(entry);
+}
+
+static inline void list_move(struct list_head* entry, struct list_head* head) {
+	list_del(entry);
+	list_add(entry, head);
+}
+
+static inline void list_splice_init(struct list_head* list, struct list_head* head) {
+	if (list_empty(list)) {
+		return;
+	}
+	list->next->prev = head;
+	list->prev->next = head->next;
+	head->next->prev = list->prev;
+	head->next = list->next;
+	INIT_LIST_HEAD(list);
+}
+
+#define list_add_rcu(entry, head) list_add((entry), (head))
+#define list_del_rcu(entry) list_del(entry)
+
+#define INIT_HLIST_HEAD(head) ((head)->first = NULL)
+#define hlist_entry(ptr, type, member) container_of(ptr, type, member)
+#define hlist_entry_safe(ptr, type, member) ({				\
+	__typeof__(ptr) ____ptr = (ptr);				\
+	____ptr ? hlist_entry(____ptr, type, member) : NULL;		\
+})
+#define hlist_first_rcu(head) (*(struct hlist_node** )&(head)->first)
+#define hlist_next_rcu(node) (*(struct hlist_node** )&(node)->next)
+#define hlist_for_each_entry_rcu(pos, head, member)					\
+	for (pos = hlist_entry_safe(READ_ONCE((head)->first), __typeof__(*(pos)), member);	\
+		pos;									\
+		pos = hlist_entry_safe(READ_ONCE((pos)->member.next), __typeof__(*(pos)), member))
+#define hlist_for_each_entry_safe(pos, n, head, member)				\
+	for (pos = hlist_entry_safe((head)->first, __typeof__(*pos), member);		\
+		pos && ({ n = pos->member.next; 1; });					\
+		pos = hlist_entry_safe(n, __typeof__(*pos), member))
+
+static inline int hlist_unhashed(const struct hlist_node* node) {
+	return node->pprev == NULL;
+}
+
+static inline void hlist_add_head_rcu(struct hlist_node* node, struct hlist_head* head) {
+	struct hlist_node* first = head->first;
+
+	node->next = first;
+	node->pprev = &head->first;
+	if (first != NULL) {
+		first->pprev = &node->next;
+	}
+	smp_store_release(&head->first, node);
+}
+
+static inline void hlist_del_init_rcu(struct hlist_node* node) {
+	if (hlist_unhashed(node)) {
+		return;
+	}
+	WRITE_ONCE(*node->pprev, node->next);
+	if (node->next != NULL) {
+		node->next->pprev = node->pprev;
+	}
+	node->pprev = NULL;
+}
+
+#define DEFINE_HASHTABLE(name, bits) struct hlist_head name[1 << (bits)]
+#define HASH_BITS(name) __builtin_ctz(ARRAY_SIZE(name))
+#define hash_min(value, bits) ((u32)(((value) >> 4)*0x9e3779b9U) >> (32 - (bits)))
+#define hash_bucket(name, key) (&(name)[hash_min((unsigned long)(key), HASH_BITS(name))])
+#define hash_add_rcu(name, node, key) hlist_add_head_rcu((node), hash_bucket(name, key))
+#define hash_del_rcu(node) hlist_del_init_rcu(node)
+#define hash_for_each_possible_rcu(name, obj, member, key) \
+	hlist_for_each_entry_rcu(obj, hash_bucket(name, key), member)
+#define hash_for_each_possible(name, obj, member, key) \
+	hash_for_each_possible_rcu(name, obj, member, key)
+#define hash_for_each_rcu(name, bkt, obj, member)				\
+	for ((bkt) = 0; (bkt) < (int)ARRAY_SIZE(name); (bkt)++)			\
+		hlist_for_each_entry_rcu(obj, &(name)[bkt], member)
+
+/* Memory */
+
+#define GFP_KERNEL 0x1U
+#define GFP_ATOMIC 0x2U
+#define GFP_NOWAIT 0x4U
+#define __GFP_ZERO 0x8U
+#define __GFP_NOWARN 0x10U
+#define __GFP_ACCOUNT 0x20U
+#define SLAB_HWCACHE_ALIGN 0x1UL
+
+// Allocations not freed yet, checked to be 0 once the module is unloaded.
+extern long stub_allocations;
+
+void* kmalloc(size_t size, gfp_t flags);
+void* kzalloc(size_t size, gfp_t flags);
+void* kcalloc(size_t n, size_t size, gfp_t flags);
+void kfree(const void* p);
+#define kmalloc_node(size, flags, node) kmalloc((size), (flags))
+#define kzalloc_node(size, flags, node) kzalloc((size), (flags))
+#define vmalloc(size) kmalloc((size), GFP_KERNEL)
+#define vzalloc_node(size, node) kzalloc((size), GFP_KERNEL)
+#define kvzalloc_node(size, flags, node) kzalloc((size), (flags))
+#define vfree(p) kfree(p)
+#define kvfree(p) kfree(p)
+#define is_vmalloc_addr(p) 0
+
+struct kmem_cache;
+struct kmem_cache* kmem_cache_create(const char* name, size_t size, size_t align,
+	unsigned long flags, void (*constructor)(void* object));
+void kmem_cache_destroy(struct kmem_cache* cache);
+// Without __GFP_ZERO the object is filled with garbage, as a reused one may be.
+void* kmem_cache_alloc(struct kmem_cache* cache, gfp_t flags);
+void kmem_cache_free(struct kmem_cache* cache, void* object);
+#define kmem_cache_zalloc(cache, flags) kmem_cache_alloc((cache), (flags) | __GFP_ZERO)
+#define kmem_cache_alloc_node(cache, flags, node) kmem_cache_alloc((cache), (flags))
+
+/* Work items */
+
+struct work_struct {
+	void (*func)(struct work_struct* work);
+	int queued;
+};
+
+// Every workqueue feeds the one list the test's kworker runs.
+struct workqueue_struct {
+	const char* name;
+};
+
+#define WQ_UNBOUND (1 << 1)
+
+#define INIT_WORK(work, function) ((work)->func = (function), (work)->queued = 0)
+struct workqueue_struct* alloc_workqueue(const char* name, unsigned int flags, int max_active);
+int queue_work(struct workqueue_struct* workqueue, struct work_struct* work);
+// Whether a work item was run; the test's kworker calls it in a loop.
+int stub_run_work(void);
+void flush_workqueue(struct workqueue_struct* workqueue);
+void destroy_workqueue(struct workqueue_struct* workqueue);
+int cancel_work_sync(struct work_struct* work);
+
+/* Time */
+
+#define HZ 100
+extern volatile unsigned long jiffies;
+#define time_after(a, b) ((long)((b) - (a)) < 0)
+#define time_before(a, b) time_after(b, a)
+
+static inline cycles_t get_cycles(void) {
+	return __builtin_ia32_rdtsc();
+}
+
+/* Tasks and seccomp */
+
+#define SYSCALL_COUNT 400
+#define MAX_ARGUMENT_COUNT 6
+#define DRACO_MAX_CUTS 128
+#define SECCOMP_RET_ALLOW 0x7fff0000U
+#define SECCOMP_RET_ERRNO 0x00050000U
+#define AUDIT_ARCH_X86_64 0xc000003eU
+
+struct pt_regs {
+	unsigned long r15, r14, r13, r12, bp, bx;
+	unsigned long r11, r10, r9, r8, ax, cx, dx, si, di, orig_ax;
+	unsigned long ip, cs, flags, sp, ss;
+};
+
+struct seccomp_data {
+	int nr;
+	u32 arch;
+	u64 instruction_pointer;
+	u64 args[6];
+};
+
+struct seccomp_filter;
+
+// As draco.patch has it.
+struct seccomp_draco_block {
+	char fill;
+	int arg_position;
+	unsigned long arg_mask[MAX_ARGUMENT_COUNT];
+	uint8_t cut_start[MAX_ARGUMENT_COUNT];
+	uint8_t cut_count[MAX_ARGUMENT_COUNT];
+	uint8_t exact;
+};
+
+struct seccomp_draco_config {
+	atomic_t usage;
+	struct seccomp_draco_block draco[SYSCALL_COUNT];
+	int draco_cut_count;
+	unsigned long draco_cuts[DRACO_MAX_CUTS];
+};
+
+struct seccomp {
+	int mode;
+	struct seccomp_filter* filter;
+	void* draco_hook;
+	void* draco_parent;
+	int draco_count;
+	int bit_map[SYSCALL_COUNT];
+	uint8_t sys2arguments[SYSCALL_COUNT][MAX_ARGUMENT_COUNT];
+	uint8_t argument_count_table[SYSCALL_COUNT];
+	struct seccomp_draco_config* draco_config;
+	int draco_generation;
+};
+
+void get_seccomp_draco(struct seccomp_draco_config* config);
+void put_seccomp_draco(struct seccomp_draco_config* config);
+
+struct signal_struct { atomic_t live; };
+
+struct task_struct {
+	pid_t pid;
+	pid_t tgid;
+	struct task_struct* group_leader;
+	struct signal_struct* signal;
+	struct seccomp seccomp;
+};
+
+// Only the simulation itself changes a task's configuration.
+#define task_lock(task) do { } while (0)
+#define task_unlock(task) do { } while (0)
+
+#define STUB_TASKS 64
+extern struct task_struct stub_tasks[STUB_TASKS];
+extern __thread struct task_struct* current;
+
+#define do_each_thread(group, thread) \
+	for ((group) = stub_tasks, (thread) = (group); (thread) < stub_tasks + STUB_TASKS; (group) = ++(thread)) {
+#define while_each_thread(group, thread) }
+
+struct pid;
+enum pid_type { PIDTYPE_PID };
+struct pid* find_get_pid(int nr);
+struct task_struct* get_pid_task(struct pid* pid, enum pid_type type);
+void put_pid(struct pid* pid);
+void put_task_struct(struct task_struct* task);
+
+/* Memory cgroups: three of them, a task is in the one of its tgid % 3 */
+
+#define CONFIG_MEMCG 1
+#define PATH_MAX 4096
+enum { memory_cgrp_id };
+
+struct cgroup { int id; };
+struct cgroup_subsys_state {
+	struct cgroup* cgroup;
+	atomic_t refs;
+};
+
+// References taken and not dropped yet, checked to be 0 after unload.
+extern atomic_t stub_css_refs;
+extern atomic_t stub_css_trygets;
+
+struct cgroup_subsys_state* task_css(struct task_struct* task, int subsys_id);
+int css_tryget(struct cgroup_subsys_state* css);
+void css_put(struct cgroup_subsys_state* css);
+int cgroup_path(struct cgroup* cgroup, char* buffer, size_t length);
+
+// The memcg grow_work charges to, on kernels that let it pick one.
+struct mem_cgroup;
+#define mem_cgroup_from_css(css) ((struct mem_cgroup* )(css))
+struct mem_cgroup* set_active_memcg(struct mem_cgroup* memcg);
+void memalloc_use_memcg(struct mem_cgroup* memcg);
+void memalloc_unuse_memcg(void);
+struct mem_cgroup* stub_active_memcg(void);
+// __GFP_ACCOUNT allocations made while a memcg was active.
+extern long stub_memcg_allocations;
+
+/* debugfs and seq_file, shown straight to a stdio stream */
+
+typedef unsigned short umode_t;
+struct file;
+struct inode;
+struct dentry;
+
+struct file_operations {
+	void* owner;
+	int (*open)(struct inode* inode, struct file* file);
+	ssize_t (*read)(struct file* file, char* buffer, size_t count, loff_t* position);
+	ssize_t (*write)(struct file* file, const char* buffer, size_t count, loff_t* position);
+	loff_t (*llseek)(struct file* file, loff_t offset, int whence);
+	int (*release)(struct inode* inode, struct file* file);
+};
+
+struct seq_file { FILE* out; };
+
+struct seq_operations {
+	void* (*start)(struct seq_file* m, loff_t* position);
+	void (*stop)(struct seq_file* m, void* v);
+	void* (*next)(struct seq_file* m, void* v, loff_t* position);
+	int (*show)(struct seq_file* m, void* v);
+};
+
+#define SEQ_START_TOKEN ((void* )1)
+#define seq_printf(m, ...) fprintf((m)->out, __VA_ARGS__)
+#define seq_puts(m, s) fputs((s), (m)->out)
+#define seq_putc(m, c) fputc((c), (m)->out)
+
+struct dentry* debugfs_create_dir(const char* name, struct dentry* parent);
+struct dentry* debugfs_create_file(const char* name, umode_t mode, struct dentry* parent,
+	void* data, const struct file_operations* fops);
+void debugfs_remove_recursive(struct dentry* dentry);
+int seq_open(struct file* file, const struct seq_operations* ops);
+ssize_t seq_read(struct file* file, char* buffer, size_t count, loff_t* position);
+loff_t seq_lseek(struct file* file, loff_t offset, int whence);
+int seq_release(struct inode* inode, struct file* file);
+int single_open(struct file* file, int (*show)(struct seq_file* m, void* v), void* data);
+int single_release(struct inode* inode, struct file* file);
+loff_t default_llseek(struct file* file, loff_t offset, int whence);
+ssize_t simple_read_from_buffer(void* to, size_t count, loff_t* position,
+	const void* from, size_t available);
+int kstrtoint_from_user(const char* buffer, size_t count, unsigned int base, int* result);
+
+#endif
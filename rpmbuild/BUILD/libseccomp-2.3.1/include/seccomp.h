@@ -96,6 +96,14 @@ struct scmp_arg_cmp {
 	scmp_datum_t datum_b;
 };
 
+/**
+ * Draco prewarm entry, a syscall and its arguments
+ */
+struct scmp_draco_entry {
+	int syscall;		/**< the native syscall number */
+	scmp_datum_t args[6];	/**< the syscall arguments */
+};
+
 /*
  * macros/defines
  */
@@ -579,6 +587,36 @@ int seccomp_export_pfc(const scmp_filter_ctx ctx, int fd);
  */
 int seccomp_export_bpf(const scmp_filter_ctx ctx, int fd);
 
+/**
+ * Prewarm the Draco cache of the calling task
+ * @param entries the syscalls and arguments
+ * @param count the number of entries
+ *
+ * This function runs each of the given syscalls and arguments through the
+ * filter loaded in the calling task, without making the calls, and has the
+ * kernel remember the verdicts, e.g. for a profile recorded in an earlier
+ * run.  It must be called after seccomp_load().  Returns zero on success,
+ * negative values on failure.
+ *
+ */
+int seccomp_draco_prewarm(const struct scmp_draco_entry *entries,
+			  unsigned int count);
+
+/**
+ * Prewarm the Draco cache of the calling task from a file
+ * @param fd the source fd
+ *
+ * This function reads struct seccomp_data records from the given fd until
+ * end of file, e.g. a cache exported through <debugfs>/draco/export by an
+ * earlier instance, and prewarms the Draco cache of the calling task with
+ * them as seccomp_draco_prewarm() does.  Every record is run through the
+ * loaded filter again, so a file from a different filter is harmless.  It
+ * must be called after seccomp_load().  Returns zero on success, negative
+ * values on failure.
+ *
+ */
+int seccomp_draco_import(int fd);
+
 /*
  * pseudo syscall definitions
  */
@@ -449,3 +449,22 @@ API int seccomp_export_bpf(const scmp_filter_ctx ctx, int fd)
 
 	return 0;
 }
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_draco_prewarm(const struct scmp_draco_entry *entries,
+			      unsigned int count)
+{
+	if (entries == NULL && count > 0)
+		return -EINVAL;
+
+	return sys_draco_prewarm(entries, count);
+}
+
+/* NOTE - function header comment in include/seccomp.h */
+API int seccomp_draco_import(int fd)
+{
+	if (fd < 0)
+		return -EINVAL;
+
+	return sys_draco_import(fd);
+}
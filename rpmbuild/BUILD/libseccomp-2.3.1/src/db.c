@@ -1544,6 +1544,23 @@ priority_failure:
 	return rc;
 }
 
+/**
+ * Tell the kernel where the outcome of a comparison may change
+ * @param syscall the syscall number
+ * @param arg the argument number
+ * @param cut the smallest value of the upper interval
+ *
+ * Values on the same side of every cut of an argument are cached by Draco
+ * as one.  A cut at zero, or one past the largest datum, splits nothing.
+ *
+ */
+static void db_draco_range(int syscall, unsigned int arg, scmp_datum_t cut)
+{
+	if (cut == 0)
+		return;
+	sys_draco_range(syscall, arg, cut);
+}
+
 /**
  * Add a new rule to the current filter
  * @param col the filter collection
@@ -1574,6 +1591,8 @@ int db_col_rule_add(struct db_filter_col *col,
 	struct db_api_arg *chain = NULL;
 	struct scmp_arg_cmp arg_data;
 	int arg_position = 0;
+	int mask_position = 0;
+	scmp_datum_t arg_mask[ARG_COUNT_MAX];
 
 	/* collect the arguments for the filter rule */
 	chain_len = ARG_COUNT_MAX;
@@ -1605,6 +1624,8 @@ int db_col_rule_add(struct db_filter_col *col,
 			case SCMP_CMP_MASKED_EQ:
 				chain[arg_num].mask = arg_data.datum_a;
 				chain[arg_num].datum = arg_data.datum_b;
+				arg_mask[arg_num] = arg_data.datum_a;
+				mask_position += (1 << arg_num);
 				break;
 			default:
 				rc = -EINVAL;
@@ -1625,6 +1646,31 @@ int db_col_rule_add(struct db_filter_col *col,
 	}
 	
 	sys_draco_add(syscall, arg_position);
+	/* only the masked bits decide a masked comparison */
+	for (iter = 0; iter < chain_len; iter++)
+		if (mask_position & (1 << iter))
+			sys_draco_mask(syscall, iter, arg_mask[iter]);
+	/* the rest only tell apart the intervals between their datums */
+	for (iter = 0; iter < arg_cnt; iter++) {
+		arg_data = arg_array[iter];
+		switch (arg_data.op) {
+		case SCMP_CMP_NE:
+		case SCMP_CMP_EQ:
+			db_draco_range(syscall, arg_data.arg, arg_data.datum_a);
+			db_draco_range(syscall, arg_data.arg, arg_data.datum_a + 1);
+			break;
+		case SCMP_CMP_LT:
+		case SCMP_CMP_GE:
+			db_draco_range(syscall, arg_data.arg, arg_data.datum_a);
+			break;
+		case SCMP_CMP_LE:
+		case SCMP_CMP_GT:
+			db_draco_range(syscall, arg_data.arg, arg_data.datum_a + 1);
+			break;
+		default:
+			break;
+		}
+	}
 
 add_return:
 	if (chain != NULL)
@@ -20,6 +20,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include <sys/prctl.h>
 
@@ -176,5 +177,72 @@ int sys_draco_add(int syscall, int arg_position)
 	return prctl(1001, syscall, arg_position);	
 }
 
+int sys_draco_mask(int syscall, int arg, scmp_datum_t mask)
+{
+	if (syscall < 0)
+		return -1;
+
+	return prctl(1002, syscall, arg, mask);
+}
+
+int sys_draco_range(int syscall, int arg, scmp_datum_t cut)
+{
+	if (syscall < 0)
+		return -1;
+
+	return prctl(1003, syscall, arg, cut);
+}
+
+int sys_draco_prewarm(const struct scmp_draco_entry *entries, unsigned int count)
+{
+	struct seccomp_data batch[DRACO_PREWARM_BATCH];
+	unsigned int i, n;
+	int j;
+
+	while (count > 0) {
+		n = count < DRACO_PREWARM_BATCH ? count : DRACO_PREWARM_BATCH;
+		memset(batch, 0, sizeof(batch));
+		for (i = 0; i < n; i++) {
+			batch[i].nr = entries[i].syscall;
+			batch[i].arch = arch_def_native->token;
+			for (j = 0; j < 6; j++)
+				batch[i].args[j] = entries[i].args[j];
+		}
+		if (prctl(1004, batch, n) < 0)
+			return -errno;
+		entries += n;
+		count -= n;
+	}
+
+	return 0;
+}
+
+int sys_draco_import(int fd)
+{
+	struct seccomp_data batch[DRACO_PREWARM_BATCH];
+	size_t have = 0;
+	ssize_t rc;
+
+	for (;;) {
+		rc = read(fd, (char *)batch + have, sizeof(batch) - have);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		have += rc;
+		if (rc > 0 && have < sizeof(batch))
+			continue;
+		if (have % sizeof(batch[0]))
+			return -EINVAL;
+		if (have > 0 &&
+		    prctl(1004, batch, have / sizeof(batch[0])) < 0)
+			return -errno;
+		if (rc == 0)
+			return 0;
+		have = 0;
+	}
+}
+
 
 
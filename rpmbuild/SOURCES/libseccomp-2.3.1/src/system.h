@@ -113,4 +113,12 @@ int sys_chk_seccomp_flag(int flag);
 
 int sys_filter_load(const struct db_filter_col *col);
 int sys_draco_add(int syscall, int arg_position);
+int sys_draco_mask(int syscall, int arg, scmp_datum_t mask);
+int sys_draco_range(int syscall, int arg, scmp_datum_t cut);
+
+/* entries handed to the kernel per prctl() */
+#define DRACO_PREWARM_BATCH		64
+
+int sys_draco_prewarm(const struct scmp_draco_entry *entries, unsigned int count);
+int sys_draco_import(int fd);
 #endif